@@ -14,10 +14,13 @@ AProceduralCubeActor::AProceduralCubeActor()
 //	static ConstructorHelpers::FObjectFinder<UMaterialInterface> Material(TEXT("Material'/Game/Materials/M_Concrete_Poured.M_Concrete_Poured'"));
 	mesh->SetMaterial(0, Material.Object);
 
+	// Hard edged box, keep a face normal per triangle
+	mesh->bFlatShading = true;
+
 	// Generate a cube
 	FProceduralMeshData data;
 	GenerateCube(100.f, data);
-	mesh->SetMeshData(data);
+	mesh->SetMeshData(MoveTemp(data), true);
 
 	RootComponent = mesh;
 }
@@ -35,6 +38,9 @@ void AProceduralCubeActor::GenerateCube(const float& InSize, FProceduralMeshData
 	OutData.VertexPositions.Add( FVector(   0.f, InSize, InSize));  //6
 	OutData.VertexPositions.Add( FVector(	0.f, InSize,	0.f));  //7
 
+	// Extents are known, spares the bounds pass
+	OutData.Bounds = FBox(FVector::ZeroVector, FVector(InSize));
+
 	//add color
 	OutData.VertexColors.Append(&FColor::Red, 8);
 
@@ -5,6 +5,34 @@
 
 #include "ProceduralMesh.h"
 #include "ProceduralLatheActor.h"
+#include "ProceduralMeshCache.h"
+#include "ProceduralMeshParallel.h"
+
+DECLARE_CYCLE_STAT(TEXT("Generate Lathe"), STAT_ProceduralMesh_GenerateLathe, STATGROUP_ProceduralMesh);
+
+/** Smaller lathes generate faster than their disk cache entry loads, so they are always generated */
+static const int32 LatheMinCachedVertices = 256 * 1024;
+
+/** GenerateLathe, through the disk cache for lathes of at least LatheMinCachedVertices. Bump the key version whenever GenerateLathe changes its output */
+static void GenerateLatheCached(const TArray<FVector>& InPoints, int32 InSegments, FProceduralMeshData& OutData, const FVector& InAxis, float InSweepAngle)
+{
+	const int32 NumRings = InSweepAngle >= 360.f ? InSegments : InSegments + 1;
+	if ((int64)NumRings * InPoints.Num() < LatheMinCachedVertices)
+	{
+		AProceduralLatheActor::GenerateLathe(InPoints, InSegments, OutData, InAxis, InSweepAngle);
+		return;
+	}
+
+	FProceduralMeshCacheKey Key(TEXT("Lathe"), 1);
+	Key.Update(InPoints);
+	Key.Update(InSegments);
+	Key.Update(InAxis);
+	Key.Update(InSweepAngle);
+	FProceduralMeshCache::GetOrGenerate(Key.Finalize(), OutData, [&](FProceduralMeshData& GeneratedData)
+	{
+		AProceduralLatheActor::GenerateLathe(InPoints, InSegments, GeneratedData, InAxis, InSweepAngle);
+	});
+}
 
 AProceduralLatheActor::AProceduralLatheActor()
 {
@@ -14,6 +42,9 @@ AProceduralLatheActor::AProceduralLatheActor()
 	static ConstructorHelpers::FObjectFinder<UMaterialInterface> Material(TEXT("/Game/Materials/BaseColor.BaseColor"));
 	mesh->SetMaterial(0, Material.Object);
 
+	// Rings are emitted one after the other, which reuses few vertices in the cache. Nothing edits the lathe by vertex index
+	mesh->bOptimizeVertexCache = true;
+
 	// Contains the points describing the polyline we are going to rotate
 	TArray<FVector> points;
 
@@ -31,112 +62,144 @@ AProceduralLatheActor::AProceduralLatheActor()
 	// Generate a Lathe from rotating the given points
 	FProceduralMeshData data;
 	GenerateLathe(points, 128, data);
-	mesh->SetMeshData(data);
+	mesh->SetMeshData(MoveTemp(data), true);
 
 	RootComponent = mesh;
 }
 
-// Generate a lathe by rotating the given polyline
-void AProceduralLatheActor::GenerateLathe(const TArray<FVector>& InPoints, const int InSegments, FProceduralMeshData& OutData)
+void AProceduralLatheActor::GenerateLatheAsync(const TArray<FVector>& InPoints, int32 InSegments, FVector InAxis, float InSweepAngle)
 {
+	// Keep the current mesh rather than swapping in the empty one GenerateLathe leaves
+	if (InPoints.Num() < 2 || InSegments < MinSegments)
+	{
+		return;
+	}
+
+	mesh->GenerateMeshSectionAsync(0, [InPoints, InSegments, InAxis, InSweepAngle](FProceduralMeshData& OutData)
+	{
+		GenerateLatheCached(InPoints, InSegments, OutData, InAxis, InSweepAngle);
+	});
+}
+
+// Generate a lathe by rotating the given polyline around an axis through the origin
+void AProceduralLatheActor::GenerateLathe(const TArray<FVector>& InPoints, const int InSegments, FProceduralMeshData& OutData, const FVector& InAxis, float InSweepAngle)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_GenerateLathe);
+
 	UE_LOG(LogClass, Log, TEXT("AProceduralLatheActor::Lathe POINTS %d"), InPoints.Num());
 
-	TArray<FVector> verts;
+	const int32 NumPoints = InPoints.Num();
+	if (NumPoints < 2 || InSegments < MinSegments)
+	{
+		return;
+	}
 
-	// precompute some trig
-	float angle = FMath::DegreesToRadians(360.0f / InSegments);
-	float sinA = FMath::Sin(angle);
-	float cosA = FMath::Cos(angle);
+	FVector Axis = InAxis.GetSafeNormal();
+	if (Axis.IsZero())
+	{
+		Axis = FVector(1.f, 0.f, 0.f);
+	}
+	const float SweepAngle = FMath::Clamp(InSweepAngle, 0.f, 360.f);
+
+	// A full turn wraps the last segment back onto the first ring, a partial sweep needs a last ring of its own
+	const bool bFullTurn = SweepAngle >= 360.f;
+	const int32 NumRings = bFullTurn ? InSegments : InSegments + 1;
 
 	/*
-	This implementation is rotation around the X Axis, other formulas below
-
-	Z Axis Rotation
-	x' = x*cos q - y*sin q
-	y' = x*sin q + y*cos q
-	z' = z
-
-	X Axis Rotation
-	y' = y*cos q - z*sin q
-	z' = y*sin q + z*cos q
-	x' = x
-
-	Y Axis Rotation
-	z' = z*cos q - x*sin q
-	x' = z*sin q + x*cos q
-	y' = y
+	Every ring is rotated from the profile directly (Rodrigues' formula), so no rounding error builds up around the revolution:
+	p' = pAxis + pPerp*cos q + (axis ^ p)*sin q
+	where pAxis is the part of p along the axis and pPerp the rest
 	*/
+	TArray<float> Sin;
+	TArray<float> Cos;
+	Sin.SetNumUninitialized(NumRings);
+	Cos.SetNumUninitialized(NumRings);
+	const float AngleStep = FMath::DegreesToRadians(SweepAngle / InSegments);
+	for (int32 Ring = 0; Ring < NumRings; Ring++)
+	{
+		FMath::SinCos(&Sin[Ring], &Cos[Ring], Ring * AngleStep);
+	}
 
-
-	int32 NumOfVertices = InPoints.Num() * InSegments + 2; //puls 2 fpr first and last point
-	OutData.VertexColors.Append(&FColor::Blue, NumOfVertices);
-
-	// Working point array, in which we keep the rotated line we draw with
-	TArray<FVector> wp;
-	for(int i = 0; i < InPoints.Num(); i++)
+	TArray<FVector> AlongAxis;
+	TArray<FVector> Perpendicular;
+	TArray<FVector> Cross;
+	AlongAxis.SetNumUninitialized(NumPoints);
+	Perpendicular.SetNumUninitialized(NumPoints);
+	Cross.SetNumUninitialized(NumPoints);
+	for (int32 Point = 0; Point < NumPoints; Point++)
 	{
-		wp.Add(InPoints[i]);
+		AlongAxis[Point] = Axis * (Axis | InPoints[Point]);
+		Perpendicular[Point] = InPoints[Point] - AlongAxis[Point];
+		Cross[Point] = Axis ^ InPoints[Point];
 	}
 
-	// Add a first and last point on the axis to complete the OutTriangles
-	FVector p0(wp[0].X, 0, 0);
-	FVector pLast(wp[wp.Num() - 1].X, 0, 0);
+	// Vertex 0 and the last vertex are on the axis and close the ends, ring r point i is 1 + r * NumPoints + i
+	const int32 NumOfVertices = NumRings * NumPoints + 2;
+	const int32 LastVertex = NumOfVertices - 1;
+	const int32 NumTriangles = InSegments * NumPoints * 2;
+
+	OutData.VertexPositions.SetNumUninitialized(NumOfVertices);
+	OutData.VertexColors.Init(FColor::Blue, NumOfVertices);
+	OutData.Indices.SetNumUninitialized(NumTriangles * 3);
 
-	OutData.VertexPositions.Add(p0);
+	OutData.VertexPositions[0] = AlongAxis[0];
+	OutData.VertexPositions[LastVertex] = AlongAxis[NumPoints - 1];
 
-	FProceduralMeshTriangle tri;
-	// for each segment draw the OutTriangles clockwise for normals pointing out or counterclockwise for the opposite (this here does CW)
-	// for each segment create the vertices and colors
-	for(int segment = 0; segment<InSegments; segment++)
+	// Rings and segments are independent, each one writes its own part of the pre-sized arrays.
+	// A ring is only a few points, so they are handed out in chunks of enough rings to be worth a worker, and all at once for small lathes
+	const int32 MinRingsPerChunk = FMath::Max(ProceduralMeshMinElementsPerChunk / NumPoints, 1);
+	FVector* Positions = OutData.VertexPositions.GetData();
+	ParallelForChunks(NumRings, [&](int32 FirstRing, int32 EndRing)
 	{
-		int32 SegmentRow = segment	 * InPoints.Num();
-		int32 SegmentNextRow = (segment < InSegments - 1) ?	(segment + 1) * InPoints.Num() : 0;
-		for(int i = 0; i<InPoints.Num() - 1; i++)
+		for (int32 Ring = FirstRing; Ring < EndRing; Ring++)
 		{
-			//wraps around at end!
-			int32 p1 = SegmentRow + i + 1;
-			int32 p2 = SegmentRow + i + 2;
-			int32 p1r = SegmentNextRow + i + 1;
-			int32 p2r = SegmentNextRow + i + 2;
-			FVector p1v = wp[i];
-			FVector p2v = wp[i + 1];
-			FVector p1rv(p1v.X, p1v.Y*cosA - p1v.Z*sinA, p1v.Y*sinA + p1v.Z*cosA);
-
-			//don't add vertex if i = 0
-			if(i == 0)
+			FVector* RingPositions = Positions + 1 + Ring * NumPoints;
+			for (int32 Point = 0; Point < NumPoints; Point++)
 			{
-				tri.Vertex0 = p1;
-				tri.Vertex1 = 0;
-				tri.Vertex2 = p1r;
-				OutData.Triangles.Add(tri);
+				RingPositions[Point] = AlongAxis[Point] + Perpendicular[Point] * Cos[Ring] + Cross[Point] * Sin[Ring];
 			}
+		}
+	}, MinRingsPerChunk);
 
-			tri.Vertex0 = p1;
-			tri.Vertex1 = p1r;
-			tri.Vertex2 = p2;
-			OutData.Triangles.Add(tri);
-
-			tri.Vertex0 = p2;
-			tri.Vertex1 = p1r;
-			tri.Vertex2 = p2r;
-			OutData.Triangles.Add(tri);
-
-			OutData.VertexPositions.Add(wp[i]);
-			wp[i] = p1rv;
+	// for each segment draw the triangles clockwise for normals pointing out or counterclockwise for the opposite (this here does CW)
+	uint32* Indices = OutData.Indices.GetData();
+	ParallelForChunks(InSegments, [&](int32 FirstSegment, int32 EndSegment)
+	{
+		for (int32 Segment = FirstSegment; Segment < EndSegment; Segment++)
+		{
+			const int32 SegmentRow = Segment * NumPoints;
+			const int32 SegmentNextRow = (Segment + 1 < NumRings) ? (Segment + 1) * NumPoints : 0;
+			uint32* Dest = Indices + Segment * NumPoints * 6;
 
-			//this has to go here to mainatin add order for vertex positions
-			if(i == InPoints.Num() - 2)
+			for (int32 i = 0; i < NumPoints - 1; i++)
 			{
-				FVector p2rv(p2v.X, p2v.Y*cosA - p2v.Z*sinA, p2v.Y*sinA + p2v.Z*cosA);
-				tri.Vertex0 = p2;
-				tri.Vertex1 = p2r;
-				tri.Vertex2 = NumOfVertices - 1;
-				OutData.Triangles.Add(tri);
-				OutData.VertexPositions.Add(wp[i + 1]);
-				wp[i + 1] = p2rv;
+				const uint32 p1 = SegmentRow + i + 1;
+				const uint32 p2 = SegmentRow + i + 2;
+				const uint32 p1r = SegmentNextRow + i + 1;
+				const uint32 p2r = SegmentNextRow + i + 2;
+
+				if (i == 0)
+				{
+					*Dest++ = p1; *Dest++ = 0; *Dest++ = p1r;
+				}
+
+				*Dest++ = p1; *Dest++ = p1r; *Dest++ = p2;
+				*Dest++ = p2; *Dest++ = p1r; *Dest++ = p2r;
+
+				if (i == NumPoints - 2)
+				{
+					*Dest++ = p2; *Dest++ = p2r; *Dest++ = LastVertex;
+				}
 			}
 		}
-	}
+	}, MinRingsPerChunk);
 
-	OutData.VertexPositions.Add(pLast);
-}
\ No newline at end of file
+	// Every point stays on a circle around the axis, whose box has an extent of r * sqrt(1 - a^2) along each world axis
+	const FVector CircleExtentScale(FMath::Sqrt(FMath::Max(0.f, 1.f - Axis.X * Axis.X)), FMath::Sqrt(FMath::Max(0.f, 1.f - Axis.Y * Axis.Y)), FMath::Sqrt(FMath::Max(0.f, 1.f - Axis.Z * Axis.Z)));
+	OutData.Bounds = FBox(0);
+	for (int32 Point = 0; Point < NumPoints; Point++)
+	{
+		const FVector Extent = CircleExtentScale * Perpendicular[Point].Size();
+		OutData.Bounds += FBox(AlongAxis[Point] - Extent, AlongAxis[Point] + Extent);
+	}
+}
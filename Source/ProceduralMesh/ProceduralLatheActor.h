@@ -21,5 +21,14 @@ public:
 	UPROPERTY(VisibleAnywhere, Category=Materials)
 	UProceduralMeshComponent* mesh;
 
-	void GenerateLathe(const TArray<FVector>& InPoints, const int InSegments, FProceduralMeshData& OutData);
+	// Fewer segments do not enclose a volume, GenerateLathe outputs nothing and GenerateLatheAsync keeps the current mesh
+	static const int32 MinSegments = 3;
+
+	// Rotate the polyline InSweepAngle degrees around InAxis (through the origin) in InSegments steps, at least MinSegments.
+	// Touches no UObject, so it can run on a worker thread
+	static void GenerateLathe(const TArray<FVector>& InPoints, const int InSegments, FProceduralMeshData& OutData, const FVector& InAxis = FVector(1.f, 0.f, 0.f), float InSweepAngle = 360.f);
+
+	// Regenerate the lathe on a worker thread, the mesh is swapped in once done (see UProceduralMeshComponent::OnMeshGenerated)
+	UFUNCTION(BlueprintCallable, Category = "Procedural Lathe")
+	void GenerateLatheAsync(const TArray<FVector>& InPoints, int32 InSegments, FVector InAxis = FVector(1.f, 0.f, 0.f), float InSweepAngle = 360.f);
 };
@@ -4,3 +4,6 @@
 
 #include "Engine.h"
 
+/** stat ProceduralMesh, the counters are declared next to the code they measure */
+DECLARE_STATS_GROUP(TEXT("ProceduralMesh"), STATGROUP_ProceduralMesh, STATCAT_Advanced);
+
@@ -0,0 +1,410 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#include "ProceduralMesh.h"
+#include "ProceduralMeshBenchmarkCommandlet.h"
+#include "ProceduralMeshComponent.h"
+#include "ProceduralMeshSimplifier.h"
+#include "ProceduralMeshOptimizer.h"
+#include "ProceduralLatheActor.h"
+#include "ProceduralSplineMesh.h"
+#include "Json.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProceduralMeshBenchmark, Log, All);
+
+/** Forwards to the allocator in use and counts what goes through it, swapped into GMalloc while the benchmark runs */
+class FProceduralMeshBenchmarkMalloc : public FMalloc
+{
+public:
+	FProceduralMeshBenchmarkMalloc(FMalloc* InInner)
+		: Inner(InInner)
+		, NumAllocations(0)
+		, BytesAllocated(0)
+		, LiveBytes(0)
+		, PeakLiveBytes(0)
+	{
+		// Live bytes can only be tracked if the allocator knows the size of its blocks
+		SIZE_T Size = 0;
+		void* Probe = Inner->Malloc(16, DEFAULT_ALIGNMENT);
+		bTracksLiveBytes = Inner->GetAllocationSize(Probe, Size);
+		Inner->Free(Probe);
+	}
+
+	// Begin FMalloc interface
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		void* Result = Inner->Malloc(Count, Alignment);
+		Added(Result, Count);
+		return Result;
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		Removed(Original);
+		void* Result = Inner->Realloc(Original, Count, Alignment);
+		Added(Result, Count);
+		return Result;
+	}
+
+	virtual void Free(void* Original) override
+	{
+		Removed(Original);
+		Inner->Free(Original);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		// GMalloc is already thread safe, the counters are atomic
+		return true;
+	}
+
+	virtual void Trim() override
+	{
+		Inner->Trim();
+	}
+
+	virtual bool ValidateHeap() override
+	{
+		return Inner->ValidateHeap();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return Inner->GetDescriptiveName();
+	}
+	// End FMalloc interface
+
+	/** Start a measurement, the peak is relative to the bytes live right now */
+	void ResetPeak()
+	{
+		PeakLiveBytes = LiveBytes;
+	}
+
+	FMalloc* Inner;
+	bool bTracksLiveBytes;
+	volatile int64 NumAllocations;
+	volatile int64 BytesAllocated;
+	volatile int64 LiveBytes;
+	volatile int64 PeakLiveBytes;
+
+private:
+	void Added(void* Ptr, SIZE_T Requested)
+	{
+		if (Ptr == NULL)
+		{
+			return;
+		}
+
+		FPlatformAtomics::InterlockedIncrement(&NumAllocations);
+		FPlatformAtomics::InterlockedAdd(&BytesAllocated, (int64)Requested);
+
+		SIZE_T Size = 0;
+		if (bTracksLiveBytes && Inner->GetAllocationSize(Ptr, Size))
+		{
+			const int64 Live = FPlatformAtomics::InterlockedAdd(&LiveBytes, (int64)Size) + (int64)Size;
+			int64 Peak = PeakLiveBytes;
+			while (Live > Peak && FPlatformAtomics::InterlockedCompareExchange(&PeakLiveBytes, Live, Peak) != Peak)
+			{
+				Peak = PeakLiveBytes;
+			}
+		}
+	}
+
+	void Removed(void* Ptr)
+	{
+		SIZE_T Size = 0;
+		if (Ptr != NULL && bTracksLiveBytes && Inner->GetAllocationSize(Ptr, Size))
+		{
+			FPlatformAtomics::InterlockedAdd(&LiveBytes, -(int64)Size);
+		}
+	}
+};
+
+/** Runs the stages and collects one JSON object per stage and mesh size */
+class FProceduralMeshBenchmark
+{
+public:
+	FProceduralMeshBenchmark(FProceduralMeshBenchmarkMalloc& InMalloc, double InMinTime)
+		: Malloc(InMalloc)
+		, MinTime(InMinTime)
+	{
+	}
+
+	/** Repeat Body until MinTime is spent, Setup and Teardown run around every iteration and are not measured */
+	void RunStage(const TCHAR* Stage, int32 Triangles, const TFunction<void()>& Setup, const TFunction<void()>& Body, const TFunction<void()>& Teardown)
+	{
+		static const int32 MaxIterations = 1000000;
+
+		int32 Iterations = 0;
+		double TotalSeconds = 0.0;
+		double MinSeconds = MAX_dbl;
+		int64 NumAllocations = 0;
+		int64 BytesAllocated = 0;
+		int64 PeakLiveBytes = 0;
+
+		while (Iterations < MaxIterations && (Iterations == 0 || TotalSeconds < MinTime))
+		{
+			Setup();
+
+			const int64 StartAllocations = Malloc.NumAllocations;
+			const int64 StartBytes = Malloc.BytesAllocated;
+			const int64 StartLive = Malloc.LiveBytes;
+			Malloc.ResetPeak();
+			const double StartTime = FPlatformTime::Seconds();
+
+			Body();
+
+			const double Seconds = FPlatformTime::Seconds() - StartTime;
+			NumAllocations += Malloc.NumAllocations - StartAllocations;
+			BytesAllocated += Malloc.BytesAllocated - StartBytes;
+			PeakLiveBytes = FMath::Max(PeakLiveBytes, Malloc.PeakLiveBytes - StartLive);
+
+			Teardown();
+
+			TotalSeconds += Seconds;
+			MinSeconds = FMath::Min(MinSeconds, Seconds);
+			Iterations++;
+		}
+
+		const double MeanSeconds = TotalSeconds / Iterations;
+		const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+		TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+		Result->SetStringField(TEXT("Stage"), Stage);
+		Result->SetNumberField(TEXT("Triangles"), Triangles);
+		Result->SetNumberField(TEXT("Iterations"), Iterations);
+		Result->SetNumberField(TEXT("MeanMs"), MeanSeconds * 1000.0);
+		Result->SetNumberField(TEXT("MinMs"), MinSeconds * 1000.0);
+		Result->SetNumberField(TEXT("TrianglesPerSecond"), MinSeconds > 0.0 ? Triangles / MinSeconds : 0.0);
+		Result->SetNumberField(TEXT("AllocationsPerIteration"), (double)NumAllocations / Iterations);
+		Result->SetNumberField(TEXT("BytesAllocatedPerIteration"), (double)BytesAllocated / Iterations);
+		Result->SetNumberField(TEXT("PeakLiveBytes"), Malloc.bTracksLiveBytes ? (double)PeakLiveBytes : -1.0);
+		Result->SetNumberField(TEXT("ProcessPeakUsedPhysical"), (double)MemoryStats.PeakUsedPhysical);
+		Results.Add(MakeShareable(new FJsonValueObject(Result)));
+
+		UE_LOG(LogProceduralMeshBenchmark, Display, TEXT("%-24s %10d tris %8d iters %10.3f ms min %10.3f ms mean %8.1f allocs"),
+			Stage, Triangles, Iterations, MinSeconds * 1000.0, MeanSeconds * 1000.0, (double)NumAllocations / Iterations);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Results;
+
+private:
+	FProceduralMeshBenchmarkMalloc& Malloc;
+	double MinTime;
+};
+
+/** A wavy profile, lathed into roughly 2 * NumPoints * Segments triangles */
+static void MakeLatheProfile(int32 NumPoints, TArray<FVector>& OutPoints)
+{
+	OutPoints.Reset(NumPoints);
+	for (int32 Point = 0; Point < NumPoints; Point++)
+	{
+		OutPoints.Add(FVector(Point * 10.f, 100.f + 20.f * FMath::Sin(Point * 0.3f), 0.f));
+	}
+}
+
+/** Samples of a gently curving road, extruded into 6 triangles per segment */
+static void MakeSplineSamples(int32 NumSegments, TArray<FProceduralSplineFrame>& OutFrames)
+{
+	OutFrames.Reset(NumSegments + 1);
+	for (int32 Sample = 0; Sample <= NumSegments; Sample++)
+	{
+		const float T = Sample * 0.01f;
+		FProceduralSplineFrame Frame;
+		Frame.Position = FVector(Sample * 100.f, 500.f * FMath::Sin(T), 50.f * FMath::Sin(T * 3.f));
+		Frame.Tangent = FVector(100.f, 5.f * FMath::Cos(T), 1.5f * FMath::Cos(T * 3.f));
+		Frame.Distance = Sample * 100.f;
+		OutFrames.Add(Frame);
+	}
+}
+
+UProceduralMeshBenchmarkCommandlet::UProceduralMeshBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UProceduralMeshBenchmarkCommandlet::Main(const FString& Params)
+{
+	static const int32 MeshSizes[] = { 1000, 10000, 100000, 1000000, 10000000 };
+	static const int32 NumLathePoints = 64;
+
+	int32 MaxTriangles = 10000000;
+	float MinTime = 0.5f;
+	FString OutputPath = FPaths::GameSavedDir() / TEXT("ProceduralMeshBenchmark.json");
+	FParse::Value(*Params, TEXT("MaxTriangles="), MaxTriangles);
+	FParse::Value(*Params, TEXT("MinTime="), MinTime);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	// Never removed, blocks allocated through it may be freed long after the benchmark
+	static FProceduralMeshBenchmarkMalloc* CountingMalloc = new FProceduralMeshBenchmarkMalloc(GMalloc);
+	GMalloc = CountingMalloc;
+
+	FProceduralMeshBenchmark Benchmark(*CountingMalloc, MinTime);
+	TFunction<void()> Nothing = [](){};
+
+	// Scene proxies read the feature level of their scene, the component is registered with this world around the render data stages
+	UWorld* World = UWorld::CreateWorld(EWorldType::Preview, false);
+
+	UProceduralMeshComponent* Component = ConstructObject<UProceduralMeshComponent>(UProceduralMeshComponent::StaticClass(), GetTransientPackage());
+	Component->AddToRoot();
+	// Collision is measured on its own through GetPhysicsTriMeshData, registering must not create a physics state and cook
+	Component->bDeferCollisionUpdates = true;
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	for (int32 Triangles : MeshSizes)
+	{
+		if (Triangles > MaxTriangles)
+		{
+			break;
+		}
+
+		// Generators
+		TArray<FVector> Profile;
+		MakeLatheProfile(NumLathePoints, Profile);
+		const int32 LatheSegments = FMath::Max(3, Triangles / (2 * NumLathePoints));
+		FProceduralMeshData LatheData;
+		Benchmark.RunStage(TEXT("GenerateLathe"), Triangles,
+			[&](){ LatheData = FProceduralMeshData(); },
+			[&](){ AProceduralLatheActor::GenerateLathe(Profile, LatheSegments, LatheData); },
+			Nothing);
+
+		TArray<FProceduralSplineFrame> SplineFrames;
+		const int32 SplineSegments = FMath::Max(1, (Triangles - 4) / 6);
+		Benchmark.RunStage(TEXT("SplineFrames"), Triangles,
+			[&](){ MakeSplineSamples(SplineSegments, SplineFrames); },
+			[&](){ AProceduralSplineMesh::ComputeFrames(SplineFrames); },
+			Nothing);
+		TArray<FProceduralMeshProfilePoint> BoxPoints;
+		UProceduralMeshProfile::MakeBox(400.f, 20.f, BoxPoints);
+		FProceduralMeshExtrusionTemplate BoxTemplate;
+		BoxTemplate.Build(BoxPoints, false, 1.f, true, 100.f);
+		FProceduralMeshData SplineData;
+		Benchmark.RunStage(TEXT("ExtrudeSpline"), Triangles,
+			[&](){ SplineData = FProceduralMeshData(); },
+			[&](){ AProceduralSplineMesh::ExtrudeMesh(SplineFrames, BoxTemplate, 0, SplineSegments, SplineData); },
+			Nothing);
+		SplineFrames.Empty();
+		SplineData = FProceduralMeshData();
+
+		// LOD chain of halving triangle counts
+		TArray<FProceduralMeshLODInfo> LODInfos;
+		LODInfos.AddDefaulted(3);
+		LODInfos[1].PercentTriangles = 0.25f;
+		LODInfos[2].PercentTriangles = 0.125f;
+		TArray<TArray<uint32>> LODIndices;
+		Benchmark.RunStage(TEXT("BuildLODs"), Triangles,
+			Nothing,
+			[&](){ FProceduralMeshSimplifier::BuildLODIndices(LatheData, LODInfos, LODIndices); },
+			Nothing);
+		LODIndices.Empty();
+
+		// Vertex cache and overdraw ordering, with the cache efficiency it buys
+		FProceduralMeshData OptimizedData;
+		FProceduralMeshVertexCacheStats CacheBefore;
+		FProceduralMeshVertexCacheStats CacheAfter;
+		Benchmark.RunStage(TEXT("OptimizeVertexCache"), Triangles,
+			[&](){ OptimizedData = LatheData; },
+			[&](){ FProceduralMeshOptimizer::Optimize(OptimizedData, &CacheBefore, &CacheAfter); },
+			Nothing);
+		UE_LOG(LogProceduralMeshBenchmark, Display, TEXT("%-24s %10d tris ACMR %.3f -> %.3f ATVR %.3f -> %.3f"),
+			TEXT("VertexCache"), Triangles, CacheBefore.ACMR, CacheAfter.ACMR, CacheBefore.ATVR, CacheAfter.ATVR);
+		OptimizedData = FProceduralMeshData();
+
+		// Validation, conversion and bounds of a new section
+		FProceduralMeshData SectionData;
+		Benchmark.RunStage(TEXT("SetMeshDataMove"), Triangles,
+			[&](){ SectionData = LatheData; },
+			[&](){ Component->SetMeshData(MoveTemp(SectionData)); },
+			Nothing);
+		Benchmark.RunStage(TEXT("SetMeshDataCopy"), Triangles,
+			Nothing,
+			[&](){ Component->SetMeshData(LatheData); },
+			Nothing);
+		Benchmark.RunStage(TEXT("UpdateMeshSection"), Triangles,
+			Nothing,
+			[&](){ Component->UpdateMeshSection(0); },
+			Nothing);
+		// The bounds reduction itself, UpdateBounds only transforms the cached box
+		FBox Bounds(0);
+		Benchmark.RunStage(TEXT("ComputePositionBounds"), Triangles,
+			Nothing,
+			[&](){ Bounds = LatheData.ComputePositionBounds(); },
+			Nothing);
+
+		// Render data, with -nullrhi the resources are created against the null RHI. Registering builds the component's own proxy once, outside the stages
+		Component->RegisterComponentWithWorld(World);
+		FPrimitiveSceneProxy* Proxy = NULL;
+		TFunction<void()> DeleteProxy = [&]()
+		{
+			FlushRenderingCommands();
+			delete Proxy;
+			Proxy = NULL;
+		};
+		// Built from scratch every time, the shared stage below measures finding the render data in the cache instead
+		Component->bShareGeometry = false;
+		Component->bFlatShading = false;
+		Benchmark.RunStage(TEXT("SceneProxy"), Triangles,
+			Nothing,
+			[&](){ Proxy = Component->CreateSceneProxy(); },
+			DeleteProxy);
+		Component->bFlatShading = true;
+		Benchmark.RunStage(TEXT("SceneProxyFlat"), Triangles,
+			Nothing,
+			[&](){ Proxy = Component->CreateSceneProxy(); },
+			DeleteProxy);
+		Component->bFlatShading = false;
+		Component->bShareGeometry = true;
+		FPrimitiveSceneProxy* SharingProxy = Component->CreateSceneProxy();
+		Benchmark.RunStage(TEXT("SceneProxyShared"), Triangles,
+			Nothing,
+			[&](){ Proxy = Component->CreateSceneProxy(); },
+			DeleteProxy);
+		FlushRenderingCommands();
+		delete SharingProxy;
+		Component->UnregisterComponent();
+		FlushRenderingCommands();
+
+		// Collision
+		FTriMeshCollisionData CollisionData;
+		Benchmark.RunStage(TEXT("GetPhysicsTriMeshData"), Triangles,
+			[&](){ CollisionData = FTriMeshCollisionData(); },
+			[&](){ Component->GetPhysicsTriMeshData(&CollisionData, true); },
+			Nothing);
+		CollisionData = FTriMeshCollisionData();
+
+		Component->ClearAllMeshSections();
+	}
+
+	Component->RemoveFromRoot();
+	World->DestroyWorld(false);
+
+	GMalloc = CountingMalloc->Inner;
+
+	TSharedRef<FJsonObject> Root = MakeShareable(new FJsonObject());
+	Root->SetStringField(TEXT("Platform"), FPlatformProperties::PlatformName());
+	Root->SetNumberField(TEXT("Cores"), FPlatformMisc::NumberOfCores());
+	Root->SetNumberField(TEXT("MinTime"), MinTime);
+	Root->SetBoolField(TEXT("TracksLiveBytes"), CountingMalloc->bTracksLiveBytes);
+	Root->SetArrayField(TEXT("Results"), Benchmark.Results);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	if (!FFileHelper::SaveStringToFile(Output, *OutputPath))
+	{
+		UE_LOG(LogProceduralMeshBenchmark, Error, TEXT("Could not write %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogProceduralMeshBenchmark, Display, TEXT("Results written to %s"), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,20 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "ProceduralMeshBenchmarkCommandlet.generated.h"
+
+/**
+ * Times the procedural mesh hot paths over mesh sizes from 1k to 10M triangles and writes throughput, allocations and memory as JSON.
+ * Needs no GPU: UE4Editor-Cmd ProceduralMesh.uproject -run=ProceduralMeshBenchmark -nullrhi [-MaxTriangles=N] [-MinTime=Seconds] [-Output=File.json]
+ */
+UCLASS()
+class UProceduralMeshBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+	// Begin UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet interface
+};
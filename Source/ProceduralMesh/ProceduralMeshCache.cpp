@@ -0,0 +1,356 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#include "ProceduralMesh.h"
+#include "ProceduralMeshCache.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mesh Cache Load"), STAT_ProceduralMesh_CacheLoad, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Mesh Cache Save"), STAT_ProceduralMesh_CacheSave, STATGROUP_ProceduralMesh);
+
+// Per frame
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mesh Cache Hits"), STAT_ProceduralMesh_CacheHits, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mesh Cache Misses"), STAT_ProceduralMesh_CacheMisses, STATGROUP_ProceduralMesh);
+
+DEFINE_LOG_CATEGORY_STATIC(LogProceduralMeshCache, Log, All);
+
+static TAutoConsoleVariable<int32> CVarProceduralMeshDiskCache(
+	TEXT("ProceduralMesh.DiskCache"),
+	1,
+	TEXT("Load generated procedural meshes from Saved/ProceduralMeshCache instead of running their generators again.\n")
+	TEXT(" 0: off, always generate\n")
+	TEXT(" 1: on (default)"));
+
+static TAutoConsoleVariable<int32> CVarProceduralMeshDiskCacheMaxMB(
+	TEXT("ProceduralMesh.DiskCacheMaxMB"),
+	256,
+	TEXT("Size of Saved/ProceduralMeshCache in MB above which the least recently used entries are deleted after each save."));
+
+FProceduralMeshCacheKey::FProceduralMeshCacheKey(const TCHAR* Generator, uint32 Version)
+{
+	Update(Generator, FCString::Strlen(Generator) * sizeof(TCHAR));
+	Update(Version);
+}
+
+void FProceduralMeshCacheKey::Update(const void* Data, int32 Size)
+{
+	Hash.Update((const uint8*)Data, Size);
+}
+
+FSHAHash FProceduralMeshCacheKey::Finalize()
+{
+	FSHAHash Result;
+	Hash.Final();
+	Hash.GetHash(Result.Hash);
+	return Result;
+}
+
+/** Bump whenever the layout below changes, older entries are then ignored and overwritten */
+static const uint32 ProceduralMeshCacheMagic = 0x434d5050; // "PPMC"
+static const uint32 ProceduralMeshCacheFormatVersion = 1;
+
+/** Streams are at least this aligned in the file, so a mapped entry could be used in place */
+static const int64 ProceduralMeshCacheAlignment = 16;
+
+/** Bit of each optional stream in FProceduralMeshCacheHeader::StreamMask, a UV channel is bit FirstUVChannel + channel */
+enum EProceduralMeshCacheStream
+{
+	PMCS_Normals = 1 << 0,
+	PMCS_Tangents = 1 << 1,
+	PMCS_FirstUVChannel = 2,
+};
+
+/** Start of an entry, followed by the streams in the order of FProceduralMeshCacheLayout */
+struct FProceduralMeshCacheHeader
+{
+	uint32 Magic;
+	uint32 FormatVersion;
+	int32 NumVertices;
+	int32 NumIndices;
+	int32 NumUVChannels;
+	uint32 StreamMask;
+	FVector BoundsMin;
+	FVector BoundsMax;
+	uint32 bBoundsValid;
+};
+
+/** File offsets of the streams of an entry, worked out from the header alone so reading needs no table of contents */
+struct FProceduralMeshCacheLayout
+{
+	int64 Positions;
+	int64 Normals;
+	int64 Tangents;
+	int64 Colors;
+	int64 UVChannels[MAX_TEXCOORDS];
+	int64 Indices;
+	int64 TotalSize;
+
+	explicit FProceduralMeshCacheLayout(const FProceduralMeshCacheHeader& Header)
+	{
+		const int64 NumVertices = Header.NumVertices;
+		int64 Offset = sizeof(FProceduralMeshCacheHeader);
+		auto Place = [&Offset](int64 Size)
+		{
+			const int64 Start = Align(Offset, ProceduralMeshCacheAlignment);
+			Offset = Start + Size;
+			return Start;
+		};
+
+		Positions = Place(NumVertices * sizeof(FVector));
+		Normals = Place((Header.StreamMask & PMCS_Normals) ? NumVertices * sizeof(FVector) : 0);
+		Tangents = Place((Header.StreamMask & PMCS_Tangents) ? NumVertices * sizeof(FVector) : 0);
+		Colors = Place(NumVertices * sizeof(FColor));
+		for (int32 Channel = 0; Channel < MAX_TEXCOORDS; Channel++)
+		{
+			const bool bHasChannel = Channel < Header.NumUVChannels && (Header.StreamMask & (1 << (PMCS_FirstUVChannel + Channel)));
+			UVChannels[Channel] = Place(bHasChannel ? NumVertices * sizeof(FVector2D) : 0);
+		}
+		Indices = Place((int64)Header.NumIndices * sizeof(uint32));
+		TotalSize = Offset;
+	}
+};
+
+static FString GetCacheDirectory()
+{
+	return FPaths::GameSavedDir() / TEXT("ProceduralMeshCache");
+}
+
+static FString GetCacheFilename(const FSHAHash& Key)
+{
+	return GetCacheDirectory() / Key.ToString() + TEXT(".pmc");
+}
+
+/** Delete the least recently used entries until the folder fits ProceduralMesh.DiskCacheMaxMB. Load touches the entries it reads */
+static void EvictEntries()
+{
+	struct FEntry
+	{
+		FString Filename;
+		FDateTime TimeStamp;
+		int64 Size;
+	};
+
+	const FString Directory = GetCacheDirectory();
+	TArray<FString> Filenames;
+	IFileManager::Get().FindFiles(Filenames, *(Directory / TEXT("*.pmc")), true, false);
+
+	TArray<FEntry> Entries;
+	int64 TotalSize = 0;
+	for (const FString& Filename : Filenames)
+	{
+		FEntry Entry;
+		Entry.Filename = Directory / Filename;
+		Entry.TimeStamp = IFileManager::Get().GetTimeStamp(*Entry.Filename);
+		Entry.Size = FMath::Max<int64>(IFileManager::Get().FileSize(*Entry.Filename), 0);
+		TotalSize += Entry.Size;
+		Entries.Add(Entry);
+	}
+
+	const int64 MaxSize = (int64)FMath::Max(CVarProceduralMeshDiskCacheMaxMB.GetValueOnAnyThread(), 0) * 1024 * 1024;
+	if (TotalSize <= MaxSize)
+	{
+		return;
+	}
+
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.TimeStamp < B.TimeStamp; });
+	for (int32 Index = 0; Index < Entries.Num() && TotalSize > MaxSize; Index++)
+	{
+		// Another worker may be evicting the same entry, only what this one deleted counts
+		if (IFileManager::Get().Delete(*Entries[Index].Filename, false, false, true))
+		{
+			TotalSize -= Entries[Index].Size;
+		}
+	}
+}
+
+/** Read Num elements at Offset straight into the storage of Array */
+template<typename T>
+static void ReadStream(FArchive& Reader, int64 Offset, int32 Num, TArray<T>& Array)
+{
+	Array.SetNumUninitialized(Num);
+	if (Num > 0)
+	{
+		Reader.Seek(Offset);
+		Reader.Serialize(Array.GetData(), Num * sizeof(T));
+	}
+}
+
+/** Pad up to Offset and write the elements of Array there */
+template<typename T>
+static void WriteStream(FArchive& Writer, int64 Offset, const TArray<T>& Array)
+{
+	static const uint8 Zeros[ProceduralMeshCacheAlignment] = { 0 };
+	check(Offset >= Writer.Tell() && Offset - Writer.Tell() < ProceduralMeshCacheAlignment);
+	Writer.Serialize((void*)Zeros, Offset - Writer.Tell());
+	Writer.Serialize((void*)Array.GetData(), Array.Num() * sizeof(T));
+}
+
+bool FProceduralMeshCache::IsEnabled()
+{
+	return CVarProceduralMeshDiskCache.GetValueOnAnyThread() != 0;
+}
+
+bool FProceduralMeshCache::Load(const FSHAHash& Key, FProceduralMeshData& OutData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_CacheLoad);
+
+	const FString Filename = GetCacheFilename(Key);
+	TAutoPtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename, FILEREAD_Silent));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	const int64 FileSize = Reader->TotalSize();
+	FProceduralMeshCacheHeader Header;
+	if (FileSize < (int64)sizeof(Header))
+	{
+		return false;
+	}
+	Reader->Serialize(&Header, sizeof(Header));
+
+	if (Header.Magic != ProceduralMeshCacheMagic || Header.FormatVersion != ProceduralMeshCacheFormatVersion ||
+		Header.NumVertices < 0 || Header.NumIndices < 0 || Header.NumIndices % 3 != 0 ||
+		Header.NumUVChannels < 0 || Header.NumUVChannels > MAX_TEXCOORDS)
+	{
+		return false;
+	}
+
+	// A truncated or padded file is not an entry this code wrote
+	const FProceduralMeshCacheLayout Layout(Header);
+	if (Layout.TotalSize != FileSize)
+	{
+		return false;
+	}
+
+	const int32 NumVertices = Header.NumVertices;
+	OutData.Triangles.Reset();
+	ReadStream(*Reader, Layout.Positions, NumVertices, OutData.VertexPositions);
+	ReadStream(*Reader, Layout.Normals, (Header.StreamMask & PMCS_Normals) ? NumVertices : 0, OutData.VertexNormals);
+	ReadStream(*Reader, Layout.Tangents, (Header.StreamMask & PMCS_Tangents) ? NumVertices : 0, OutData.VertexTangents);
+	ReadStream(*Reader, Layout.Colors, NumVertices, OutData.VertexColors);
+	OutData.UVChannels.SetNum(Header.NumUVChannels);
+	for (int32 Channel = 0; Channel < Header.NumUVChannels; Channel++)
+	{
+		const bool bHasChannel = (Header.StreamMask & (1 << (PMCS_FirstUVChannel + Channel))) != 0;
+		ReadStream(*Reader, Layout.UVChannels[Channel], bHasChannel ? NumVertices : 0, OutData.UVChannels[Channel].UVs);
+	}
+	ReadStream(*Reader, Layout.Indices, Header.NumIndices, OutData.Indices);
+
+	OutData.Bounds = Header.bBoundsValid ? FBox(Header.BoundsMin, Header.BoundsMax) : FBox(0);
+
+	if (Reader->IsError())
+	{
+		return false;
+	}
+
+	// Entries are trusted by the component (see CreateMeshSection), so a damaged one must not get past here
+	for (uint32 Index : OutData.Indices)
+	{
+		if (Index >= (uint32)NumVertices)
+		{
+			return false;
+		}
+	}
+
+	// Most recently used, see EvictEntries
+	Reader.Reset();
+	IFileManager::Get().SetTimeStamp(*Filename, FDateTime::UtcNow());
+
+	return true;
+}
+
+void FProceduralMeshCache::Save(const FSHAHash& Key, const FProceduralMeshData& Data)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_CacheSave);
+
+	const int32 NumVertices = Data.VerteciesNum();
+	if (Data.Triangles.Num() != 0 || Data.UVChannels.Num() > MAX_TEXCOORDS || Data.VertexColors.Num() != NumVertices)
+	{
+		return;
+	}
+
+	FProceduralMeshCacheHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = ProceduralMeshCacheMagic;
+	Header.FormatVersion = ProceduralMeshCacheFormatVersion;
+	Header.NumVertices = NumVertices;
+	Header.NumIndices = Data.Indices.Num();
+	Header.NumUVChannels = Data.UVChannels.Num();
+	Header.StreamMask = (Data.VertexNormals.Num() == NumVertices ? PMCS_Normals : 0) | (Data.VertexTangents.Num() == NumVertices ? PMCS_Tangents : 0);
+	for (int32 Channel = 0; Channel < Data.UVChannels.Num(); Channel++)
+	{
+		if (Data.UVChannels[Channel].UVs.Num() == NumVertices)
+		{
+			Header.StreamMask |= 1 << (PMCS_FirstUVChannel + Channel);
+		}
+	}
+	Header.BoundsMin = Data.Bounds.Min;
+	Header.BoundsMax = Data.Bounds.Max;
+	Header.bBoundsValid = Data.Bounds.IsValid;
+
+	// Written under a name of its own and moved in place once complete, concurrent writers of the same entry write identical files
+	const FString Filename = GetCacheFilename(Key);
+	const FString TempFilename = Filename + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+	{
+		TAutoPtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempFilename, FILEWRITE_Silent));
+		if (!Writer.IsValid())
+		{
+			return;
+		}
+
+		static const TArray<FVector> NoVectors;
+		static const TArray<FVector2D> NoUVs;
+		const FProceduralMeshCacheLayout Layout(Header);
+		Writer->Serialize(&Header, sizeof(Header));
+		WriteStream(*Writer, Layout.Positions, Data.VertexPositions);
+		WriteStream(*Writer, Layout.Normals, (Header.StreamMask & PMCS_Normals) ? Data.VertexNormals : NoVectors);
+		WriteStream(*Writer, Layout.Tangents, (Header.StreamMask & PMCS_Tangents) ? Data.VertexTangents : NoVectors);
+		WriteStream(*Writer, Layout.Colors, Data.VertexColors);
+		for (int32 Channel = 0; Channel < Data.UVChannels.Num(); Channel++)
+		{
+			const bool bHasChannel = (Header.StreamMask & (1 << (PMCS_FirstUVChannel + Channel))) != 0;
+			WriteStream(*Writer, Layout.UVChannels[Channel], bHasChannel ? Data.UVChannels[Channel].UVs : NoUVs);
+		}
+		WriteStream(*Writer, Layout.Indices, Data.Indices);
+
+		if (!Writer->Close())
+		{
+			Writer.Reset();
+			IFileManager::Get().Delete(*TempFilename, false, false, true);
+			return;
+		}
+	}
+
+	if (!IFileManager::Get().Move(*Filename, *TempFilename, true, true, false, true))
+	{
+		UE_LOG(LogProceduralMeshCache, Warning, TEXT("Could not write %s"), *Filename);
+		IFileManager::Get().Delete(*TempFilename, false, false, true);
+		return;
+	}
+
+	EvictEntries();
+}
+
+bool FProceduralMeshCache::GetOrGenerate(const FSHAHash& Key, FProceduralMeshData& OutData, const FProceduralMeshGenerator& Generator)
+{
+	if (IsEnabled() && Load(Key, OutData))
+	{
+		INC_DWORD_STAT(STAT_ProceduralMesh_CacheHits);
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_ProceduralMesh_CacheMisses);
+
+	// A failed load may have left anything in there
+	OutData.ResetTriangles();
+	OutData.ResetVertices();
+	OutData.UVChannels.Reset();
+	Generator(OutData);
+
+	// Entries hold the indexed layout, triangle based generators are converted once here
+	if (OutData.ConvertTriangles() && IsEnabled())
+	{
+		Save(Key, OutData);
+	}
+
+	return false;
+}
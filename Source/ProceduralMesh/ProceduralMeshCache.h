@@ -0,0 +1,57 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "ProceduralMeshComponent.h"
+
+/** Hash of a generator and everything its output depends on, names its cache entry */
+class PROCEDURALMESH_API FProceduralMeshCacheKey
+{
+public:
+	/** Bump Version whenever the generator changes its output for the same inputs */
+	FProceduralMeshCacheKey(const TCHAR* Generator, uint32 Version);
+
+	void Update(const void* Data, int32 Size);
+
+	/** Plain old data only */
+	template<typename T>
+	void Update(const T& Value)
+	{
+		Update(&Value, sizeof(T));
+	}
+
+	/** Prefixed with the size, so different splits of the same bytes do not collide */
+	template<typename T>
+	void Update(const TArray<T>& Values)
+	{
+		const int32 Num = Values.Num();
+		Update(&Num, sizeof(Num));
+		Update(Values.GetData(), Num * sizeof(T));
+	}
+
+	FSHAHash Finalize();
+
+private:
+	FSHA1 Hash;
+};
+
+/**
+ * Generated mesh data on disk (Saved/ProceduralMeshCache), so levels load without running the generators again.
+ * Used on load paths only: large lathes and spline sections built at construction or by a final edit. Steps of an interactive edit and small meshes (the cube) just generate.
+ * An entry is a header followed by the raw streams at 16 byte aligned offsets, read straight into the arrays of the mesh data.
+ * The least recently used entries are deleted past ProceduralMesh.DiskCacheMaxMB. Disabled with ProceduralMesh.DiskCache 0, delete the folder to clear it
+ */
+class PROCEDURALMESH_API FProceduralMeshCache
+{
+public:
+	/** Fill OutData from the entry of Key, false if there is none or it does not hold valid mesh data */
+	static bool Load(const FSHAHash& Key, FProceduralMeshData& OutData);
+
+	/** Write Data as the entry of Key, the file is moved in place once complete so readers never see half of it. Evicts old entries past the size cap */
+	static void Save(const FSHAHash& Key, const FProceduralMeshData& Data);
+
+	/** Load the entry of Key, or run Generator and save its result. True if it came from the cache. Safe on worker threads */
+	static bool GetOrGenerate(const FSHAHash& Key, FProceduralMeshData& OutData, const FProceduralMeshGenerator& Generator);
+
+	static bool IsEnabled();
+};
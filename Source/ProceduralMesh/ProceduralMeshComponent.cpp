@@ -4,338 +4,2372 @@
 
 #include "ProceduralMesh.h"
 #include "DynamicMeshBuilder.h"
+#include "ParallelFor.h"
 #include "ProceduralMeshComponent.h"
+#include "ProceduralMeshOptimizer.h"
+#include "ProceduralMeshParallel.h"
+#include "ProceduralMeshSimplifier.h"
 #include "Runtime/Launch/Resources/Version.h"
 
+DECLARE_CYCLE_STAT(TEXT("Validate Mesh Data"), STAT_ProceduralMesh_Validate, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Section Changed"), STAT_ProceduralMesh_SectionChanged, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Create Scene Proxy"), STAT_ProceduralMesh_CreateSceneProxy, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Build Section Render Data"), STAT_ProceduralMesh_BuildSection, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Hash Render Data"), STAT_ProceduralMesh_HashRenderData, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("RHI Upload"), STAT_ProceduralMesh_Upload, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Update Section Vertices"), STAT_ProceduralMesh_UpdateVertices, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Update Vertex Colors"), STAT_ProceduralMesh_UpdateVertexColors, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Generate Section (Async)"), STAT_ProceduralMesh_GenerateAsync, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Update Collision"), STAT_ProceduralMesh_UpdateCollision, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Build Collision Data"), STAT_ProceduralMesh_BuildCollisionData, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Cook Collision"), STAT_ProceduralMesh_Cook, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Update Bounds"), STAT_ProceduralMesh_UpdateBounds, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Calc Bounds"), STAT_ProceduralMesh_CalcBounds, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Draw Static Elements"), STAT_ProceduralMesh_DrawStaticElements, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Get Dynamic Mesh Elements"), STAT_ProceduralMesh_GetDynamicMeshElements, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Draw Dynamic Elements"), STAT_ProceduralMesh_DrawDynamicElements, STATGROUP_ProceduralMesh);
+
+// Per frame
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scene Proxies Created"), STAT_ProceduralMesh_ProxiesCreated, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sections Built"), STAT_ProceduralMesh_SectionsBuilt, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sections Shared"), STAT_ProceduralMesh_SectionsShared, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Collision Cooks"), STAT_ProceduralMesh_CollisionCooks, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bytes Uploaded"), STAT_ProceduralMesh_BytesUploaded, STATGROUP_ProceduralMesh);
+
+// Live
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Scene Proxies"), STAT_ProceduralMesh_Proxies, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Render Sections"), STAT_ProceduralMesh_Sections, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Render Vertices"), STAT_ProceduralMesh_Vertices, STATGROUP_ProceduralMesh);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Render Indices"), STAT_ProceduralMesh_Indices, STATGROUP_ProceduralMesh);
+DECLARE_MEMORY_STAT(TEXT("Render Data CPU"), STAT_ProceduralMesh_RenderDataCPU, STATGROUP_ProceduralMesh);
+DECLARE_MEMORY_STAT(TEXT("Render Data GPU"), STAT_ProceduralMesh_RenderDataGPU, STATGROUP_ProceduralMesh);
+
 void FProceduralMeshData::ResetTriangles()
 {
+	Indices.Reset();
 	Triangles.Reset();
 }
 
-void FProceduralMeshData::ResetVertices()
-{
-	VertexPositions.Reset();
-	VertexColors.Reset();
-}
+void FProceduralMeshData::ResetVertices()
+{
+	VertexPositions.Reset();
+	VertexNormals.Reset();
+	VertexTangents.Reset();
+	VertexColors.Reset();
+	for (FProceduralMeshUVChannel& Channel : UVChannels)
+	{
+		Channel.UVs.Reset();
+	}
+	Bounds.Init();
+}
+
+int32 FProceduralMeshData::TrianglesNum() const
+{
+	return Indices.Num() / 3 + Triangles.Num();
+}
+
+int32 FProceduralMeshData::VerteciesNum() const
+{
+	return VertexPositions.Num();
+}
+
+SIZE_T FProceduralMeshData::GetAllocatedSize() const
+{
+	SIZE_T Size = VertexPositions.GetAllocatedSize() + VertexNormals.GetAllocatedSize() + VertexTangents.GetAllocatedSize() + VertexColors.GetAllocatedSize() +
+		UVChannels.GetAllocatedSize() + Indices.GetAllocatedSize() + Triangles.GetAllocatedSize();
+	for (const FProceduralMeshUVChannel& Channel : UVChannels)
+	{
+		Size += Channel.UVs.GetAllocatedSize();
+	}
+	return Size;
+}
+
+bool FProceduralMeshData::ConvertTriangles()
+{
+	if (Triangles.Num() == 0)
+	{
+		return true;
+	}
+
+	const int32 NumVertices = VertexPositions.Num();
+	for (const FProceduralMeshTriangle& Triangle : Triangles)
+	{
+		if (!(VertexPositions.IsValidIndex(Triangle.Vertex0) &&
+			VertexPositions.IsValidIndex(Triangle.Vertex1) &&
+			VertexPositions.IsValidIndex(Triangle.Vertex2)))
+		{
+			return false;
+		}
+	}
+
+	if (UVChannels.Num() == 0)
+	{
+		UVChannels.AddDefaulted();
+	}
+
+	// Per corner UVs go to the first UV channel. The first corner of a vertex sets its UV, later corners
+	// with a different UV get a copy of the vertex appended at the end, linked through NextCopy.
+	TArray<FVector2D>& UVs = UVChannels[0].UVs;
+	UVs.SetNumZeroed(NumVertices);
+
+	TArray<bool> bHasUV;
+	bHasUV.Init(false, NumVertices);
+
+	TArray<int32> NextCopy;
+	NextCopy.Init(INDEX_NONE, NumVertices);
+
+	Indices.Reserve(Indices.Num() + Triangles.Num() * 3);
+
+	for (const FProceduralMeshTriangle& Triangle : Triangles)
+	{
+		const int32 Corners[3] = { Triangle.Vertex0, Triangle.Vertex1, Triangle.Vertex2 };
+		const FProceduralMeshVertexUV* CornerUVs[3] = { &Triangle.UV0, &Triangle.UV1, &Triangle.UV2 };
+
+		for (int32 Corner = 0; Corner < 3; Corner++)
+		{
+			const int32 VertIdx = Corners[Corner];
+			const FVector2D UV(CornerUVs[Corner]->U, CornerUVs[Corner]->V);
+
+			if (!bHasUV[VertIdx])
+			{
+				bHasUV[VertIdx] = true;
+				UVs[VertIdx] = UV;
+				Indices.Add(VertIdx);
+				continue;
+			}
+
+			int32 CopyIdx = VertIdx;
+			while (UVs[CopyIdx] != UV && NextCopy[CopyIdx] != INDEX_NONE)
+			{
+				CopyIdx = NextCopy[CopyIdx];
+			}
+
+			if (UVs[CopyIdx] != UV)
+			{
+				const int32 NewIdx = DuplicateVertex(VertIdx);
+				UVs[NewIdx] = UV;
+				NextCopy.Add(INDEX_NONE);
+				NextCopy[CopyIdx] = NewIdx;
+				CopyIdx = NewIdx;
+			}
+
+			Indices.Add(CopyIdx);
+		}
+	}
+
+	Triangles.Empty();
+
+	return true;
+}
+
+int32 FProceduralMeshData::DuplicateVertex(int32 VertIdx)
+{
+	const int32 NewIdx = VertexPositions.Add(VertexPositions[VertIdx]);
+	if (VertexNormals.IsValidIndex(VertIdx))
+	{
+		VertexNormals.Add(VertexNormals[VertIdx]);
+	}
+	if (VertexTangents.IsValidIndex(VertIdx))
+	{
+		VertexTangents.Add(VertexTangents[VertIdx]);
+	}
+	if (VertexColors.IsValidIndex(VertIdx))
+	{
+		VertexColors.Add(VertexColors[VertIdx]);
+	}
+	for (FProceduralMeshUVChannel& Channel : UVChannels)
+	{
+		if (Channel.UVs.IsValidIndex(VertIdx))
+		{
+			Channel.UVs.Add(Channel.UVs[VertIdx]);
+		}
+	}
+	return NewIdx;
+}
+
+void FProceduralMeshSection::Reset()
+{
+	MeshData.ResetTriangles();
+	MeshData.ResetVertices();
+	LocalBox.Init();
+	LODIndices.Empty();
+	bVerticesRenumbered = false;
+}
+
+/** Min/max reduction over positions, four independent accumulators keep the vector units busy */
+FBox FProceduralMeshData::ComputePositionBounds() const
+{
+	const int32 Num = VertexPositions.Num();
+	if (Num == 0)
+	{
+		return FBox(0);
+	}
+
+	const FVector* Data = VertexPositions.GetData();
+	VectorRegister Min0 = VectorLoadFloat3(Data);
+	VectorRegister Max0 = Min0;
+	VectorRegister Min1 = Min0, Max1 = Min0, Min2 = Min0, Max2 = Min0, Min3 = Min0, Max3 = Min0;
+
+	// Unaligned 4 float loads pick up the next X in W which is never stored, so they are safe for all but the last position
+	const int32 NumLoad4 = Num - 1;
+	int32 Idx = 0;
+	for (; Idx + 4 <= NumLoad4; Idx += 4)
+	{
+		const VectorRegister P0 = VectorLoad(&Data[Idx].X);
+		const VectorRegister P1 = VectorLoad(&Data[Idx + 1].X);
+		const VectorRegister P2 = VectorLoad(&Data[Idx + 2].X);
+		const VectorRegister P3 = VectorLoad(&Data[Idx + 3].X);
+		Min0 = VectorMin(Min0, P0);
+		Max0 = VectorMax(Max0, P0);
+		Min1 = VectorMin(Min1, P1);
+		Max1 = VectorMax(Max1, P1);
+		Min2 = VectorMin(Min2, P2);
+		Max2 = VectorMax(Max2, P2);
+		Min3 = VectorMin(Min3, P3);
+		Max3 = VectorMax(Max3, P3);
+	}
+	for (; Idx < NumLoad4; Idx++)
+	{
+		const VectorRegister P = VectorLoad(&Data[Idx].X);
+		Min0 = VectorMin(Min0, P);
+		Max0 = VectorMax(Max0, P);
+	}
+	const VectorRegister PLast = VectorLoadFloat3(&Data[Num - 1]);
+	Min0 = VectorMin(VectorMin(VectorMin(Min0, Min1), VectorMin(Min2, Min3)), PLast);
+	Max0 = VectorMax(VectorMax(VectorMax(Max0, Max1), VectorMax(Max2, Max3)), PLast);
+
+	FBox Box(0);
+	VectorStoreFloat3(Min0, &Box.Min);
+	VectorStoreFloat3(Max0, &Box.Max);
+	Box.IsValid = 1;
+	return Box;
+}
+
+void FProceduralMeshSection::UpdateLocalBox()
+{
+	LocalBox.Init();
+	if (MeshData.TrianglesNum() > 0)
+	{
+		LocalBox = MeshData.Bounds.IsValid ? MeshData.Bounds : MeshData.ComputePositionBounds();
+	}
+}
+
+
+/** Vertex layout of the position/tangent stream, colors and UVs live in their own streams */
+struct FProceduralMeshVertex
+{
+	FVector Position;
+	FPackedNormal TangentX;
+	FPackedNormal TangentZ;
+
+	void SetTangents(const FVector& InTangentX, const FVector& InTangentY, const FVector& InTangentZ)
+	{
+		TangentX = InTangentX;
+		TangentZ = InTangentZ;
+		// store determinant of basis in w component of normal vector
+		TangentZ.Vector.W = GetBasisDeterminantSign(InTangentX, InTangentY, InTangentZ) < 0.0f ? 0 : 255;
+	}
+};
+
+/** FProceduralMeshVertex with the position in 16 bit steps over the box of its section, 16 instead of 20 bytes.
+ * Read as normalized shorts (VET_Short4N), the shader gets floats in -1..1 like the float3 it expects. W is MAX_int16, which reads as 1 */
+struct FProceduralMeshQuantizedVertex
+{
+	int16 Position[4];
+	FPackedNormal TangentX;
+	FPackedNormal TangentZ;
+};
+
+/** Vertex Buffer */
+class FProceduralMeshVertexBuffer : public FVertexBuffer
+{
+public:
+	TArray<FProceduralMeshVertex> Vertices;
+
+	/** Replaces Vertices once Quantize is called */
+	TArray<FProceduralMeshQuantizedVertex> QuantizedVertices;
+
+	/** Rewritten every frame or so through UpdateVertices */
+	bool bDynamic;
+
+	/** Keep Vertices after the upload, otherwise they are freed */
+	bool bNeedsCPUAccess;
+
+	/** Holds QuantizedVertices */
+	bool bQuantized;
+
+	FProceduralMeshVertexBuffer()
+		: bDynamic(false)
+		, bNeedsCPUAccess(true)
+		, bQuantized(false)
+	{
+	}
+
+	/** Move Vertices into QuantizedVertices, local position = Origin + Position / MAX_int16 * Scale (the normalized value times Scale) */
+	void Quantize(const FVector& Origin, const FVector& Scale)
+	{
+		check(!bDynamic);
+
+		const FVector InvScale(MAX_int16 / Scale.X, MAX_int16 / Scale.Y, MAX_int16 / Scale.Z);
+		QuantizedVertices.SetNumUninitialized(Vertices.Num());
+		ParallelForChunks(Vertices.Num(), [&](int32 First, int32 End)
+		{
+			for (int32 VertIdx = First; VertIdx < End; VertIdx++)
+			{
+				const FProceduralMeshVertex& Vert = Vertices[VertIdx];
+				const FVector Steps = (Vert.Position - Origin) * InvScale;
+
+				FProceduralMeshQuantizedVertex& QuantizedVert = QuantizedVertices[VertIdx];
+				QuantizedVert.Position[0] = (int16)FMath::Clamp(FMath::RoundToInt(Steps.X), -MAX_int16, (int32)MAX_int16);
+				QuantizedVert.Position[1] = (int16)FMath::Clamp(FMath::RoundToInt(Steps.Y), -MAX_int16, (int32)MAX_int16);
+				QuantizedVert.Position[2] = (int16)FMath::Clamp(FMath::RoundToInt(Steps.Z), -MAX_int16, (int32)MAX_int16);
+				QuantizedVert.Position[3] = MAX_int16;
+				QuantizedVert.TangentX = Vert.TangentX;
+				QuantizedVert.TangentZ = Vert.TangentZ;
+			}
+		});
+
+		Vertices.Empty();
+		bQuantized = true;
+	}
+
+	/** Bytes of the vertex data, the same on the CPU and the GPU */
+	uint32 GetSize() const
+	{
+		return bQuantized ? QuantizedVertices.Num() * sizeof(FProceduralMeshQuantizedVertex) : Vertices.Num() * sizeof(FProceduralMeshVertex);
+	}
+
+	virtual void InitRHI() override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, GetSize());
+
+		const void* Data = bQuantized ? (const void*)QuantizedVertices.GetData() : (const void*)Vertices.GetData();
+
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(GetSize(), bDynamic ? BUF_Dynamic : BUF_Static, CreateInfo);
+		// Copy the vertex data into the vertex buffer.
+		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, GetSize(), RLM_WriteOnly);
+		FMemory::Memcpy(VertexBufferData, Data, GetSize());
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+
+		if (!bNeedsCPUAccess)
+		{
+			Vertices.Empty();
+			QuantizedVertices.Empty();
+		}
+	}
+
+	/** Overwrite the whole buffer, must be called on the rendering thread */
+	void UpdateVertices(const TArray<FProceduralMeshVertex>& NewVertices)
+	{
+		check(IsInRenderingThread() && bDynamic);
+
+		if (!IsInitialized())
+		{
+			return;
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, NewVertices.Num() * sizeof(FProceduralMeshVertex));
+
+		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, NewVertices.Num() * sizeof(FProceduralMeshVertex), RLM_WriteOnly);
+		FMemory::Memcpy(VertexBufferData, NewVertices.GetData(), NewVertices.Num() * sizeof(FProceduralMeshVertex));
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+	}
+};
+
+/** UV Vertex Buffer, all UV channels of a vertex interleaved */
+class FProceduralMeshUVVertexBuffer : public FVertexBuffer
+{
+public:
+	TArray<FVector2D> UVs;
+	int32 NumChannels;
+
+	/** Replaces UVs once ConvertToHalfPrecision is called */
+	TArray<FVector2DHalf> HalfUVs;
+
+	/** Keep UVs after the upload, otherwise they are freed */
+	bool bNeedsCPUAccess;
+
+	/** Holds HalfUVs */
+	bool bHalfPrecision;
+
+	FProceduralMeshUVVertexBuffer()
+		: NumChannels(1)
+		, bNeedsCPUAccess(true)
+		, bHalfPrecision(false)
+	{
+	}
+
+	/** Move UVs into HalfUVs, 11 bits of mantissa are plenty for texture coordinates within a few repeats */
+	void ConvertToHalfPrecision()
+	{
+		HalfUVs.SetNumUninitialized(UVs.Num());
+		ParallelForChunks(UVs.Num(), [&](int32 First, int32 End)
+		{
+			for (int32 Idx = First; Idx < End; Idx++)
+			{
+				HalfUVs[Idx] = FVector2DHalf(UVs[Idx]);
+			}
+		});
+
+		UVs.Empty();
+		bHalfPrecision = true;
+	}
+
+	/** Size of one UV channel of one vertex */
+	uint32 GetUVSize() const
+	{
+		return bHalfPrecision ? sizeof(FVector2DHalf) : sizeof(FVector2D);
+	}
+
+	/** Bytes of the UV data, the same on the CPU and the GPU */
+	uint32 GetSize() const
+	{
+		return (bHalfPrecision ? HalfUVs.Num() : UVs.Num()) * GetUVSize();
+	}
+
+	virtual void InitRHI() override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, GetSize());
+
+		const void* Data = bHalfPrecision ? (const void*)HalfUVs.GetData() : (const void*)UVs.GetData();
+
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(GetSize(), BUF_Static, CreateInfo);
+		// Copy the UV data into the vertex buffer.
+		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, GetSize(), RLM_WriteOnly);
+		FMemory::Memcpy(VertexBufferData, Data, GetSize());
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+
+		if (!bNeedsCPUAccess)
+		{
+			UVs.Empty();
+			HalfUVs.Empty();
+		}
+	}
+};
+
+/** Color Vertex Buffer, kept dynamic so ranges of it can be rewritten without recreating the proxy */
+class FProceduralMeshColorVertexBuffer : public FVertexBuffer
+{
+public:
+	TArray<FColor> Colors;
+
+	/** Keep Colors after the upload, otherwise they are freed */
+	bool bNeedsCPUAccess;
+
+	FProceduralMeshColorVertexBuffer()
+		: bNeedsCPUAccess(true)
+	{
+	}
+
+	virtual void InitRHI() override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, Colors.Num() * sizeof(FColor));
+
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(Colors.Num() * sizeof(FColor), BUF_Dynamic, CreateInfo);
+		// Copy the color data into the vertex buffer.
+		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, Colors.Num() * sizeof(FColor), RLM_WriteOnly);
+		FMemory::Memcpy(VertexBufferData, Colors.GetData(), Colors.Num() * sizeof(FColor));
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+
+		if (!bNeedsCPUAccess)
+		{
+			Colors.Empty();
+		}
+	}
+
+	/** Write NewColors over [First, First + Count) on the GPU and in Colors if it is kept, must be called on the rendering thread */
+	void UpdateRange(int32 First, const FColor* NewColors, int32 Count)
+	{
+		check(IsInRenderingThread());
+
+		if (Count <= 0 || !IsInitialized())
+		{
+			return;
+		}
+
+		if (Colors.Num() > 0)
+		{
+			FMemory::Memcpy(&Colors[First], NewColors, Count * sizeof(FColor));
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, Count * sizeof(FColor));
+
+		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, First * sizeof(FColor), Count * sizeof(FColor), RLM_WriteOnly);
+		FMemory::Memcpy(VertexBufferData, NewColors, Count * sizeof(FColor));
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+	}
+};
+
+/** Index Buffer, stored as 16 bit indices when the vertex count allows it and 32 bit otherwise */
+class FProceduralMeshIndexBuffer : public FIndexBuffer
+{
+public:
+	/** Keep the indices after the upload, otherwise they are freed */
+	bool bNeedsCPUAccess;
+
+	FProceduralMeshIndexBuffer()
+		: bNeedsCPUAccess(true)
+		, b32Bit(false)
+	{
+	}
+
+	/** Take the indices, packing them down to 16 bit if every one of NumVertices can be addressed that way */
+	void SetIndices(TArray<uint32>&& InIndices, int32 NumVertices)
+	{
+		b32Bit = NumVertices > MAX_uint16 + 1;
+		if (b32Bit)
+		{
+			Indices32 = MoveTemp(InIndices);
+			Indices16.Empty();
+		}
+		else
+		{
+			Indices16.SetNumUninitialized(InIndices.Num());
+			ParallelForChunks(InIndices.Num(), [&](int32 First, int32 End)
+			{
+				for (int32 Idx = First; Idx < End; Idx++)
+				{
+					Indices16[Idx] = (uint16)InIndices[Idx];
+				}
+			});
+			Indices32.Empty();
+			InIndices.Empty();
+		}
+	}
+
+	int32 Num() const
+	{
+		return b32Bit ? Indices32.Num() : Indices16.Num();
+	}
+
+	bool Is32Bit() const
+	{
+		return b32Bit;
+	}
+
+	/** Bytes of the index data, the same on the CPU and the GPU */
+	uint32 GetSize() const
+	{
+		return Num() * (b32Bit ? sizeof(uint32) : sizeof(uint16));
+	}
+
+	virtual void InitRHI() override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Upload);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_BytesUploaded, GetSize());
+
+		const uint32 Stride = b32Bit ? sizeof(uint32) : sizeof(uint16);
+		const void* Data = b32Bit ? (const void*)Indices32.GetData() : (const void*)Indices16.GetData();
+
+		FRHIResourceCreateInfo CreateInfo;
+		IndexBufferRHI = RHICreateIndexBuffer(Stride, Num() * Stride, BUF_Static, CreateInfo);
+		// Write the indices to the index buffer.
+		void* Buffer = RHILockIndexBuffer(IndexBufferRHI, 0, Num() * Stride, RLM_WriteOnly);
+		FMemory::Memcpy(Buffer, Data, Num() * Stride);
+		RHIUnlockIndexBuffer(IndexBufferRHI);
+
+		if (!bNeedsCPUAccess)
+		{
+			Indices16.Empty();
+			Indices32.Empty();
+		}
+	}
+
+private:
+	TArray<uint16> Indices16;
+	TArray<uint32> Indices32;
+	bool b32Bit;
+};
+
+/** Vertex Factory */
+class FProceduralMeshVertexFactory : public FLocalVertexFactory
+{
+public:
+	FProceduralMeshVertexFactory()
+	{
+	}
+
+	/** Initialization */
+	void Init(const FProceduralMeshVertexBuffer* VertexBuffer, const FProceduralMeshColorVertexBuffer* ColorBuffer, const FProceduralMeshUVVertexBuffer* UVBuffer)
+	{
+		// Commented out to enable building light of a level (but no backing is done for the procedural mesh itself)
+		//check(!IsInRenderingThread());
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+			InitProceduralMeshVertexFactory,
+			FProceduralMeshVertexFactory*, VertexFactory, this,
+			const FProceduralMeshVertexBuffer*, VertexBuffer, VertexBuffer,
+			const FProceduralMeshColorVertexBuffer*, ColorBuffer, ColorBuffer,
+			const FProceduralMeshUVVertexBuffer*, UVBuffer, UVBuffer,
+		{
+			// Initialize the vertex factory's stream components.
+			DataType NewData;
+			if (VertexBuffer->bQuantized)
+			{
+				// Normalized, so the float4 position input gets floats on every RHI (plain shorts bind as integers on D3D11).
+				// Dequantized by the section's own primitive uniform buffer, see FProceduralMeshSceneProxy::UpdateQuantizedUniformBuffers
+				NewData.PositionComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshQuantizedVertex,Position,VET_Short4N);
+				NewData.TangentBasisComponents[0] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshQuantizedVertex,TangentX,VET_PackedNormal);
+				NewData.TangentBasisComponents[1] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshQuantizedVertex,TangentZ,VET_PackedNormal);
+			}
+			else
+			{
+				NewData.PositionComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshVertex,Position,VET_Float3);
+				NewData.TangentBasisComponents[0] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshVertex,TangentX,VET_PackedNormal);
+				NewData.TangentBasisComponents[1] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FProceduralMeshVertex,TangentZ,VET_PackedNormal);
+			}
+			// One interleaved stream holds every UV channel
+			const uint32 UVSize = UVBuffer->GetUVSize();
+			for (int32 Channel = 0; Channel < UVBuffer->NumChannels; Channel++)
+			{
+				NewData.TextureCoordinates.Add(
+					FVertexStreamComponent(UVBuffer, UVSize * Channel, UVSize * UVBuffer->NumChannels, UVBuffer->bHalfPrecision ? VET_Half2 : VET_Float2)
+					);
+			}
+			// Colors come from their own tightly packed stream
+			NewData.ColorComponent = FVertexStreamComponent(ColorBuffer, 0, sizeof(FColor), VET_Color);
+			VertexFactory->SetData(NewData);
+		});
+	}
+};
+
+
+
+/** Component settings a section's render data is built with, see UProceduralMeshComponent::GetRenderSettings */
+struct FProceduralMeshRenderSettings
+{
+	/** One render vertex per mesh vertex, otherwise one per corner (flat shading) */
+	bool bWeld;
+	bool bDynamic;
+	bool bReleaseCPUData;
+	bool bHalfPrecisionUVs;
+	bool bQuantizePositions;
+
+	/** Looked up in and added to the geometry cache */
+	bool bShared;
+
+	FProceduralMeshRenderSettings()
+		: bWeld(false)
+		, bDynamic(false)
+		, bReleaseCPUData(false)
+		, bHalfPrecisionUVs(false)
+		, bQuantizePositions(false)
+		, bShared(false){}
+
+	bool operator==(const FProceduralMeshRenderSettings& Other) const
+	{
+		return bWeld == Other.bWeld && bDynamic == Other.bDynamic && bReleaseCPUData == Other.bReleaseCPUData &&
+			bHalfPrecisionUVs == Other.bHalfPrecisionUVs && bQuantizePositions == Other.bQuantizePositions && bShared == Other.bShared;
+	}
+};
+
+/** Render data of a single mesh section, shared by every proxy drawing the same geometry (see UProceduralMeshComponent::CreateProxySection) */
+class FProceduralMeshProxySection
+{
+public:
+	FProceduralMeshVertexBuffer VertexBuffer;
+	FProceduralMeshColorVertexBuffer ColorBuffer;
+	FProceduralMeshUVVertexBuffer UVBuffer;
+	FProceduralMeshIndexBuffer IndexBuffer;
+	FProceduralMeshVertexFactory VertexFactory;
+
+	/** Prefix offsets from a mesh vertex to the first render vertex built from it, empty when they map one to one */
+	TArray<int32> FirstRenderVertex;
+
+	/** Range [LODFirstIndex[LOD], LODFirstIndex[LOD + 1]) of the index buffer drawn for each LOD, LOD 0 is the full mesh */
+	TArray<int32> LODFirstIndex;
+
+	/** The rest of the ring of position and tangent streams of a dynamic section after VertexBuffer, each with its own vertex factory so
+	 * an update never writes to a buffer the GPU may still be reading */
+	TIndirectArray<FProceduralMeshVertexBuffer> ExtraVertexBuffers;
+	TIndirectArray<FProceduralMeshVertexFactory> ExtraVertexFactories;
+
+	/** Ring index of the buffer drawn, 0 is VertexBuffer */
+	int32 CurrentVertexBuffer;
+
+	/** Vertices are rewritten through UpdateVertices_RenderThread */
+	bool bDynamic;
+
+	/** Size of the position/tangent and color streams, their CPU copies may be gone */
+	int32 NumRenderVertices;
+
+	/** Positions are stored normalized to -1..1 over QuantizationScale around QuantizationOrigin, see GetDequantizationMatrix */
+	bool bQuantized;
+	FVector QuantizationOrigin;
+	FVector QuantizationScale;
+
+	/** Bytes kept on the CPU once uploaded and bytes of the GPU buffers, fixed at construction so the game thread can read them */
+	SIZE_T CPUSize;
+	SIZE_T GPUSize;
+
+	/** What the section was built with, and its key in the geometry cache when Settings.bShared (see HashRenderData) */
+	FProceduralMeshRenderSettings Settings;
+	FSHAHash CacheKey;
+
+	/** Handed out again by the geometry cache, so more than one section may draw it. Only touched on the game thread */
+	bool bCacheHit;
+
+	/** Length of the ring: the buffer drawn, one the GPU may still read from the frame before and one to write */
+	static const int32 NumDynamicVertexBuffers = 3;
+
+	/** Build the render vertices and indices of a section into exactly sized arrays, the large loops spread over the task graph.
+	 * Touches nothing but its arguments and creates no render resource, so it can run on any thread; InitResources hands it to the render thread.
+	 * Dynamic sections keep their position and tangent stream in a ring of dynamic buffers, see UpdateVertices_RenderThread.
+	 * With bReleaseCPUData the buffers free their data once uploaded. bHalfPrecisionUVs and bQuantizePositions pick the compact vertex format,
+	 * positions of dynamic sections are never quantized since their bounds keep changing */
+	FProceduralMeshProxySection(const FProceduralMeshData& Data, const TArray<TArray<uint32>>& LODIndices, const FProceduralMeshRenderSettings& InSettings)
+		: CurrentVertexBuffer(0)
+		, bDynamic(InSettings.bDynamic)
+		, bQuantized(InSettings.bQuantizePositions && !InSettings.bDynamic)
+		, QuantizationOrigin(0.f)
+		, QuantizationScale(1.f)
+		, Settings(InSettings)
+		, bCacheHit(false)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_BuildSection);
+
+		const bool bWeld = Settings.bWeld;
+		TArray<uint32> LODChainIndices;
+		const TArray<uint32>& Indices = GetIndexChain(Data, LODIndices, LODChainIndices, LODFirstIndex);
+		const TArray<FColor>& VertexColors = Data.VertexColors;
+		const int32 NumSourceVertices = Data.VerteciesNum();
+		const int32 NumCorners = Indices.Num();
+		const int32 NumUVChannels = FMath::Clamp(Data.UVChannels.Num(), 1, (int32)MAX_STATIC_TEXCOORDS);
+
+		// Welded every mesh vertex is one render vertex, flat shaded every corner is
+		NumRenderVertices = bWeld ? NumSourceVertices : NumCorners;
+
+		TArray<uint32> RenderIndices;
+
+		if (bWeld)
+		{
+			// The mesh data is indexed already, every mesh vertex is exactly one render vertex.
+			// Identity mapping, see UpdateVertexColors_RenderThread
+			FirstRenderVertex.Empty();
+
+			ColorBuffer.Colors = VertexColors;
+			RenderIndices.Append(Indices.GetData(), NumCorners);
+
+			BuildUVs(Data, NumUVChannels, TArray<int32>());
+		}
+		else
+		{
+			// Every corner of every LOD gets its own render vertex with the face normal (flat shading).
+			// Render vertices are grouped by the mesh vertex they come from (counting sort), so that a range of mesh vertices
+			// maps onto a single contiguous range of the color stream: [FirstRenderVertex[Start], FirstRenderVertex[Start + Count])
+			CountRenderVertices(Indices, NumSourceVertices, FirstRenderVertex);
+			AssignRenderVertices(Indices, FirstRenderVertex, RenderIndices);
+
+			TArray<int32> SourceVertex;
+			SourceVertex.SetNumUninitialized(NumCorners);
+			ColorBuffer.Colors.SetNumUninitialized(NumCorners);
+			// Every corner owns its render vertex, so chunks of corners never write the same element
+			ParallelForChunks(NumCorners, [&](int32 First, int32 End)
+			{
+				for (int32 CornerIdx = First; CornerIdx < End; CornerIdx++)
+				{
+					const int32 VertIdx = Indices[CornerIdx];
+					const int32 RenderIdx = RenderIndices[CornerIdx];
+
+					ColorBuffer.Colors[RenderIdx] = VertexColors[VertIdx];
+					SourceVertex[RenderIdx] = VertIdx;
+				}
+			});
+
+			BuildUVs(Data, NumUVChannels, SourceVertex);
+		}
+
+		BuildVertices(Data, Indices, LODFirstIndex[1], FirstRenderVertex, VertexBuffer.Vertices);
+		VertexBuffer.bDynamic = bDynamic;
+
+		if (bQuantized)
+		{
+			// The full int16 range spans the box, degenerate axes keep a non zero step
+			const FBox Box = Data.Bounds.IsValid ? Data.Bounds : Data.ComputePositionBounds();
+			QuantizationOrigin = Box.GetCenter();
+			QuantizationScale = Box.GetExtent().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+			VertexBuffer.Quantize(QuantizationOrigin, QuantizationScale);
+		}
+
+		if (Settings.bHalfPrecisionUVs)
+		{
+			UVBuffer.ConvertToHalfPrecision();
+		}
+
+		// Index format is picked from the final vertex count
+		IndexBuffer.SetIndices(MoveTemp(RenderIndices), NumRenderVertices);
+
+		// The rest of the ring shares the color, UV and index buffers. Copied before any upload, which may free the vertices
+		for (int32 RingIdx = 1; bDynamic && RingIdx < NumDynamicVertexBuffers; RingIdx++)
+		{
+			FProceduralMeshVertexBuffer* RingVertexBuffer = new FProceduralMeshVertexBuffer();
+			RingVertexBuffer->Vertices = VertexBuffer.Vertices;
+			RingVertexBuffer->bDynamic = true;
+			ExtraVertexBuffers.Add(RingVertexBuffer);
+
+			ExtraVertexFactories.Add(new FProceduralMeshVertexFactory());
+		}
+
+		// Sizes are taken before the render thread can free anything
+		const SIZE_T BufferSize = VertexBuffer.GetSize() * (1 + ExtraVertexBuffers.Num()) + ColorBuffer.Colors.Num() * sizeof(FColor) +
+			UVBuffer.GetSize() + IndexBuffer.GetSize();
+		GPUSize = BufferSize;
+		CPUSize = FirstRenderVertex.GetAllocatedSize() + LODFirstIndex.GetAllocatedSize() + ExtraVertexBuffers.Num() * (sizeof(FProceduralMeshVertexBuffer) + sizeof(FProceduralMeshVertexFactory));
+		if (!Settings.bReleaseCPUData)
+		{
+			CPUSize += BufferSize;
+		}
+
+		INC_DWORD_STAT(STAT_ProceduralMesh_SectionsBuilt);
+		INC_DWORD_STAT(STAT_ProceduralMesh_Sections);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_Vertices, NumRenderVertices);
+		INC_DWORD_STAT_BY(STAT_ProceduralMesh_Indices, LODFirstIndex.Last());
+		INC_MEMORY_STAT_BY(STAT_ProceduralMesh_RenderDataCPU, CPUSize);
+		INC_MEMORY_STAT_BY(STAT_ProceduralMesh_RenderDataGPU, GPUSize);
+	}
+
+	/** Enqueue the upload of the buffers built by the constructor, once, from the game thread */
+	void InitResources()
+	{
+		check(IsInGameThread());
+
+		const bool bNeedsCPUAccess = !Settings.bReleaseCPUData;
+		VertexBuffer.bNeedsCPUAccess = bNeedsCPUAccess;
+		ColorBuffer.bNeedsCPUAccess = bNeedsCPUAccess;
+		UVBuffer.bNeedsCPUAccess = bNeedsCPUAccess;
+		IndexBuffer.bNeedsCPUAccess = bNeedsCPUAccess;
+
+		// Init vertex factory
+		VertexFactory.Init(&VertexBuffer, &ColorBuffer, &UVBuffer);
+
+		// Enqueue initialization of render resource
+		BeginInitResource(&VertexBuffer);
+		BeginInitResource(&ColorBuffer);
+		BeginInitResource(&UVBuffer);
+		BeginInitResource(&IndexBuffer);
+		BeginInitResource(&VertexFactory);
+
+		for (int32 RingIdx = 0; RingIdx < ExtraVertexBuffers.Num(); RingIdx++)
+		{
+			ExtraVertexBuffers[RingIdx].bNeedsCPUAccess = bNeedsCPUAccess;
+			ExtraVertexFactories[RingIdx].Init(&ExtraVertexBuffers[RingIdx], &ColorBuffer, &UVBuffer);
+			BeginInitResource(&ExtraVertexBuffers[RingIdx]);
+			BeginInitResource(&ExtraVertexFactories[RingIdx]);
+		}
+	}
+
+	/** Build a section owned by a pointer that releases it on the render thread, wherever its last reference goes */
+	static FProceduralMeshProxySectionPtr Create(const FProceduralMeshData& Data, const TArray<TArray<uint32>>& LODIndices, const FProceduralMeshRenderSettings& InSettings);
+
+	/** Releases the render resources, so it only runs on the render thread (see Create) */
+	~FProceduralMeshProxySection()
+	{
+		DEC_DWORD_STAT(STAT_ProceduralMesh_Sections);
+		DEC_DWORD_STAT_BY(STAT_ProceduralMesh_Vertices, NumRenderVertices);
+		DEC_DWORD_STAT_BY(STAT_ProceduralMesh_Indices, LODFirstIndex.Last());
+		DEC_MEMORY_STAT_BY(STAT_ProceduralMesh_RenderDataCPU, CPUSize);
+		DEC_MEMORY_STAT_BY(STAT_ProceduralMesh_RenderDataGPU, GPUSize);
+
+		VertexBuffer.ReleaseResource();
+		ColorBuffer.ReleaseResource();
+		UVBuffer.ReleaseResource();
+		IndexBuffer.ReleaseResource();
+		VertexFactory.ReleaseResource();
+
+		for (int32 RingIdx = 0; RingIdx < ExtraVertexBuffers.Num(); RingIdx++)
+		{
+			ExtraVertexBuffers[RingIdx].ReleaseResource();
+			ExtraVertexFactories[RingIdx].ReleaseResource();
+		}
+	}
+
+	/** The full mesh followed by the LODs, Data.Indices itself when there are none. OutLODFirstIndex receives where each LOD starts */
+	static const TArray<uint32>& GetIndexChain(const FProceduralMeshData& Data, const TArray<TArray<uint32>>& LODIndices, TArray<uint32>& Storage, TArray<int32>& OutLODFirstIndex)
+	{
+		// The LODs follow the full mesh in the same index buffer and use the same vertices
+		OutLODFirstIndex.Reset();
+		OutLODFirstIndex.Add(0);
+		OutLODFirstIndex.Add(Data.Indices.Num());
+		if (LODIndices.Num() == 0)
+		{
+			return Data.Indices;
+		}
+
+		int32 NumLODChainIndices = Data.Indices.Num();
+		for (const TArray<uint32>& LOD : LODIndices)
+		{
+			NumLODChainIndices += LOD.Num();
+		}
+
+		Storage.Reset(NumLODChainIndices);
+		Storage.Append(Data.Indices);
+		for (const TArray<uint32>& LOD : LODIndices)
+		{
+			Storage.Append(LOD);
+			OutLODFirstIndex.Add(Storage.Num());
+		}
+		return Storage;
+	}
+
+	/** Prefix sum of the number of corners of each mesh vertex, the flat shaded render vertices of a mesh vertex are consecutive */
+	static void CountRenderVertices(const TArray<uint32>& Indices, int32 NumSourceVertices, TArray<int32>& OutFirstRenderVertex)
+	{
+		OutFirstRenderVertex.Init(0, NumSourceVertices + 1);
+		for (int32 CornerIdx = 0; CornerIdx < Indices.Num(); CornerIdx++)
+		{
+			OutFirstRenderVertex[Indices[CornerIdx] + 1]++;
+		}
+		for (int32 VertIdx = 0; VertIdx < NumSourceVertices; VertIdx++)
+		{
+			OutFirstRenderVertex[VertIdx + 1] += OutFirstRenderVertex[VertIdx];
+		}
+	}
+
+	/** Flat shaded render vertex of every corner, in corner order within the range of its mesh vertex (see CountRenderVertices) */
+	static void AssignRenderVertices(const TArray<uint32>& Indices, const TArray<int32>& FirstRenderVertex, TArray<uint32>& OutCornerRenderVertex)
+	{
+		TArray<int32> NextRenderVertex(FirstRenderVertex);
+		OutCornerRenderVertex.SetNumUninitialized(Indices.Num());
+		for (int32 CornerIdx = 0; CornerIdx < Indices.Num(); CornerIdx++)
+		{
+			OutCornerRenderVertex[CornerIdx] = NextRenderVertex[Indices[CornerIdx]]++;
+		}
+	}
+
+	/** Position and tangent basis of every render vertex: one per mesh vertex when FirstRenderVertex is empty, otherwise one flat shaded vertex per corner laid out by it.
+	 * Only the first NumBaseCorners of Indices (the full mesh) shape smooth normals. Touches nothing but its arguments, so it runs on the game thread for dynamic updates */
+	static void BuildVertices(const FProceduralMeshData& Data, const TArray<uint32>& Indices, int32 NumBaseCorners, const TArray<int32>& FirstRenderVertex, TArray<FProceduralMeshVertex>& OutVertices)
+	{
+		const TArray<FVector>& VertexPositions = Data.VertexPositions;
+		const int32 NumSourceVertices = VertexPositions.Num();
+		const bool bWeld = FirstRenderVertex.Num() == 0;
+		const bool bHasNormals = Data.VertexNormals.Num() == NumSourceVertices;
+		const bool bHasTangents = Data.VertexTangents.Num() == NumSourceVertices;
+
+		// Face tangent basis, the cross product is left unnormalized so smooth normals are area weighted.
+		// Welded vertices only need the faces of the full mesh, and none at all when the mesh data has both normals and tangents
+		const int32 NumFaceCorners = bWeld ? ((bHasNormals && bHasTangents) ? 0 : NumBaseCorners) : Indices.Num();
+		const int32 NumTriangles = NumFaceCorners / 3;
+		TArray<FVector> FaceTangentX;
+		TArray<FVector> FaceTangentZ;
+		FaceTangentX.SetNumUninitialized(NumTriangles);
+		FaceTangentZ.SetNumUninitialized(NumTriangles);
+		ParallelForChunks(NumTriangles, [&](int32 First, int32 End)
+		{
+			for (int32 TriIdx = First; TriIdx < End; TriIdx++)
+			{
+				const FVector& P0 = VertexPositions[Indices[TriIdx * 3 + 0]];
+				const FVector Edge01 = (VertexPositions[Indices[TriIdx * 3 + 1]] - P0);
+				const FVector Edge02 = (VertexPositions[Indices[TriIdx * 3 + 2]] - P0);
+
+				FaceTangentX[TriIdx] = Edge01.GetSafeNormal();
+				FaceTangentZ[TriIdx] = Edge02 ^ Edge01;
+			}
+		});
+
+		if (bWeld)
+		{
+			// Normals and tangents come from the mesh data when given, otherwise they are averaged from the faces.
+			TArray<FVector> SmoothTangentX;
+			TArray<FVector> SmoothTangentZ;
+			if (!bHasNormals || !bHasTangents)
+			{
+				SmoothTangentX.SetNumZeroed(NumSourceVertices);
+				SmoothTangentZ.SetNumZeroed(NumSourceVertices);
+				// Only the full mesh shapes the normals, the LODs share them. Corners scatter onto shared vertices, so this stays serial
+				for (int32 CornerIdx = 0; CornerIdx < NumFaceCorners; CornerIdx++)
+				{
+					SmoothTangentX[Indices[CornerIdx]] += FaceTangentX[CornerIdx / 3];
+					SmoothTangentZ[Indices[CornerIdx]] += FaceTangentZ[CornerIdx / 3];
+				}
+			}
+
+			OutVertices.SetNumUninitialized(NumSourceVertices);
+			ParallelForChunks(NumSourceVertices, [&](int32 First, int32 End)
+			{
+				for (int32 VertIdx = First; VertIdx < End; VertIdx++)
+				{
+					const FVector BaseTangentX = bHasTangents ? Data.VertexTangents[VertIdx] : SmoothTangentX[VertIdx];
+					const FVector TangentZ = (bHasNormals ? Data.VertexNormals[VertIdx] : SmoothTangentZ[VertIdx]).GetSafeNormal();
+					// Keep the tangent orthogonal to the (possibly averaged) normal
+					const FVector TangentX = (BaseTangentX - TangentZ * (TangentZ | BaseTangentX)).GetSafeNormal();
+					const FVector TangentY = (TangentX ^ TangentZ).GetSafeNormal();
+
+					FProceduralMeshVertex& Vert = OutVertices[VertIdx];
+					Vert.Position = VertexPositions[VertIdx];
+					Vert.SetTangents(TangentX, TangentY, TangentZ);
+				}
+			});
+		}
+		else
+		{
+			TArray<uint32> CornerRenderVertex;
+			AssignRenderVertices(Indices, FirstRenderVertex, CornerRenderVertex);
+			OutVertices.SetNumUninitialized(Indices.Num());
+			ParallelForChunks(Indices.Num(), [&](int32 First, int32 End)
+			{
+				for (int32 CornerIdx = First; CornerIdx < End; CornerIdx++)
+				{
+					const int32 VertIdx = Indices[CornerIdx];
+					const int32 TriIdx = CornerIdx / 3;
+
+					const FVector TangentX = FaceTangentX[TriIdx];
+					const FVector TangentZ = FaceTangentZ[TriIdx].GetSafeNormal();
+					const FVector TangentY = (TangentX ^ TangentZ).GetSafeNormal();
+
+					FProceduralMeshVertex& Vert = OutVertices[CornerRenderVertex[CornerIdx]];
+					Vert.Position = VertexPositions[VertIdx];
+					Vert.SetTangents(TangentX, TangentY, TangentZ);
+				}
+			});
+		}
+	}
+
+	/** Write new render vertices (see BuildVertices) into the next buffer of the ring and draw from it, the topology has to be the one the section was built with */
+	void UpdateVertices_RenderThread(const TArray<FProceduralMeshVertex>& NewVertices)
+	{
+		check(IsInRenderingThread());
+
+		if (!bDynamic || NewVertices.Num() != NumRenderVertices)
+		{
+			return;
+		}
+
+		CurrentVertexBuffer = (CurrentVertexBuffer + 1) % (ExtraVertexBuffers.Num() + 1);
+		FProceduralMeshVertexBuffer& RingVertexBuffer = CurrentVertexBuffer == 0 ? VertexBuffer : ExtraVertexBuffers[CurrentVertexBuffer - 1];
+		RingVertexBuffer.UpdateVertices(NewVertices);
+	}
+
+	/** The vertex factory reading the current buffer of the ring */
+	const FProceduralMeshVertexFactory& GetVertexFactory() const
+	{
+		return CurrentVertexBuffer == 0 ? VertexFactory : ExtraVertexFactories[CurrentVertexBuffer - 1];
+	}
+
+	/** Copy new colors for mesh vertices [Start, Start + NewColors.Num()) into the color stream and upload only that range */
+	void UpdateVertexColors_RenderThread(int32 Start, const TArray<FColor>& NewColors)
+	{
+		check(IsInRenderingThread());
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_UpdateVertexColors);
+
+		const int32 End = Start + NewColors.Num();
+
+		// Welded, mesh vertices are the render vertices
+		if (FirstRenderVertex.Num() == 0)
+		{
+			if (Start < 0 || End > NumRenderVertices)
+			{
+				return;
+			}
+
+			ColorBuffer.UpdateRange(Start, NewColors.GetData(), NewColors.Num());
+			return;
+		}
+
+		if (Start < 0 || End >= FirstRenderVertex.Num())
+		{
+			return;
+		}
+
+		// Expanded to the render vertices of the range, the color stream itself may not be kept on the CPU
+		const int32 FirstRenderIdx = FirstRenderVertex[Start];
+		TArray<FColor> RenderColors;
+		RenderColors.SetNumUninitialized(FirstRenderVertex[End] - FirstRenderIdx);
+		for (int32 VertIdx = Start; VertIdx < End; VertIdx++)
+		{
+			const FColor& Color = NewColors[VertIdx - Start];
+			for (int32 RenderIdx = FirstRenderVertex[VertIdx]; RenderIdx < FirstRenderVertex[VertIdx + 1]; RenderIdx++)
+			{
+				RenderColors[RenderIdx - FirstRenderIdx] = Color;
+			}
+		}
+
+		ColorBuffer.UpdateRange(FirstRenderIdx, RenderColors.GetData(), RenderColors.Num());
+	}
+
+	int32 GetNumLODs() const
+	{
+		return LODFirstIndex.Num() - 1;
+	}
+
+	/** Normalized -1..1 positions to local space, goes in front of the local to world transform */
+	FMatrix GetDequantizationMatrix() const
+	{
+		return FScaleMatrix(QuantizationScale) * FTranslationMatrix(QuantizationOrigin);
+	}
+
+private:
+	/** Interleave the UV channels of every render vertex, SourceVertex maps render to mesh vertices (empty for one to one) */
+	void BuildUVs(const FProceduralMeshData& Data, int32 NumUVChannels, const TArray<int32>& SourceVertex)
+	{
+		UVBuffer.NumChannels = NumUVChannels;
+		UVBuffer.UVs.SetNumZeroed(NumRenderVertices * NumUVChannels);
+
+		for (int32 Channel = 0; Channel < NumUVChannels && Channel < Data.UVChannels.Num(); Channel++)
+		{
+			const TArray<FVector2D>& ChannelUVs = Data.UVChannels[Channel].UVs;
+			if (ChannelUVs.Num() != Data.VerteciesNum())
+			{
+				continue;
+			}
+
+			ParallelForChunks(NumRenderVertices, [&](int32 First, int32 End)
+			{
+				for (int32 RenderIdx = First; RenderIdx < End; RenderIdx++)
+				{
+					const int32 VertIdx = SourceVertex.Num() > 0 ? SourceVertex[RenderIdx] : RenderIdx;
+					UVBuffer.UVs[RenderIdx * NumUVChannels + Channel] = ChannelUVs[VertIdx];
+				}
+			});
+		}
+	}
+};
+
+/** The last reference to a section can go on the game thread (geometry cache, component) or a worker (unused prebuilt render data),
+ * its render resources are released and it is deleted on the render thread */
+struct FProceduralMeshProxySectionDeleter
+{
+	void operator()(FProceduralMeshProxySection* Section) const
+	{
+		if (IsInRenderingThread())
+		{
+			delete Section;
+			return;
+		}
+
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			FProceduralMeshDeleteSection,
+			FProceduralMeshProxySection*, Section, Section,
+		{
+			delete Section;
+		});
+	}
+};
+
+FProceduralMeshProxySectionPtr FProceduralMeshProxySection::Create(const FProceduralMeshData& Data, const TArray<TArray<uint32>>& LODIndices, const FProceduralMeshRenderSettings& InSettings)
+{
+	return FProceduralMeshProxySectionPtr(new FProceduralMeshProxySection(Data, LODIndices, InSettings), FProceduralMeshProxySectionDeleter());
+}
+
+/** Hash of the inputs of FProceduralMeshProxySection, touches nothing but its arguments */
+static FSHAHash HashRenderData(const FProceduralMeshData& Data, const TArray<TArray<uint32>>& LODIndices, const FProceduralMeshRenderSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_HashRenderData);
+
+	FSHA1 Hash;
+
+	// Every array is prefixed with its size, so different splits of the same bytes do not collide
+	auto UpdateArray = [&Hash](const void* Elements, int32 Num, int32 ElementSize)
+	{
+		Hash.Update((const uint8*)&Num, sizeof(Num));
+		Hash.Update((const uint8*)Elements, Num * ElementSize);
+	};
+
+	// bShared and bDynamic never differ between sections sharing render data, they do not go in
+	const uint8 Flags = (Settings.bWeld ? 1 : 0) | (Settings.bReleaseCPUData ? 2 : 0) | (Settings.bHalfPrecisionUVs ? 4 : 0) | (Settings.bQuantizePositions ? 8 : 0);
+	Hash.Update(&Flags, sizeof(Flags));
+	UpdateArray(Data.VertexPositions.GetData(), Data.VertexPositions.Num(), sizeof(FVector));
+	UpdateArray(Data.VertexNormals.GetData(), Data.VertexNormals.Num(), sizeof(FVector));
+	UpdateArray(Data.VertexTangents.GetData(), Data.VertexTangents.Num(), sizeof(FVector));
+	UpdateArray(Data.VertexColors.GetData(), Data.VertexColors.Num(), sizeof(FColor));
+	UpdateArray(Data.UVChannels.GetData(), Data.UVChannels.Num(), 0);
+	for (const FProceduralMeshUVChannel& Channel : Data.UVChannels)
+	{
+		UpdateArray(Channel.UVs.GetData(), Channel.UVs.Num(), sizeof(FVector2D));
+	}
+	UpdateArray(Data.Indices.GetData(), Data.Indices.Num(), sizeof(uint32));
+	UpdateArray(LODIndices.GetData(), LODIndices.Num(), 0);
+	for (const TArray<uint32>& LOD : LODIndices)
+	{
+		UpdateArray(LOD.GetData(), LOD.Num(), sizeof(uint32));
+	}
+
+	FSHAHash Result;
+	Hash.Final();
+	Hash.GetHash(Result.Hash);
+	return Result;
+}
+
+/** Scene proxy */
+class FProceduralMeshSceneProxy : public FPrimitiveSceneProxy
+{
+public:
+
+	FProceduralMeshSceneProxy(UProceduralMeshComponent* Component)
+		: FPrimitiveSceneProxy(Component)
+		, bStaticDrawPath(Component->bStaticProxy)
+		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+	{
+		Sections.SetNum(Component->Sections.Num());
+		Materials.SetNum(Component->Sections.Num());
+		for (int32 SectionIdx = 0; SectionIdx < Component->Sections.Num(); SectionIdx++)
+		{
+			Sections[SectionIdx] = Component->CreateProxySection(SectionIdx);
+
+			Materials[SectionIdx] = Component->GetMaterial(SectionIdx);
+			if (Materials[SectionIdx] == NULL)
+			{
+				Materials[SectionIdx] = UMaterial::GetDefaultMaterial(MD_Surface);
+			}
+		}
+
+		for (const FProceduralMeshLODInfo& LODInfo : Component->LODs)
+		{
+			LODScreenSizes.Add(LODInfo.ScreenSize);
+		}
+
+		// Created on the render thread once the transform is known, see CreateRenderThreadResources
+		QuantizedUniformBuffers.SetNumZeroed(Sections.Num());
+
+		INC_DWORD_STAT(STAT_ProceduralMesh_ProxiesCreated);
+		INC_DWORD_STAT(STAT_ProceduralMesh_Proxies);
+	}
+
+	virtual ~FProceduralMeshSceneProxy()
+	{
+		// Shared sections are deleted with their last proxy
+		DEC_DWORD_STAT(STAT_ProceduralMesh_Proxies);
+
+		for (TUniformBuffer<FPrimitiveUniformShaderParameters>* UniformBuffer : QuantizedUniformBuffers)
+		{
+			if (UniformBuffer != NULL)
+			{
+				UniformBuffer->ReleaseResource();
+				delete UniformBuffer;
+			}
+		}
+	}
+
+	/** Runs after the transform is set and before the first DrawStaticElements or view, so no quantized section is drawn without its uniform buffer */
+	virtual void CreateRenderThreadResources() override
+	{
+		UpdateQuantizedUniformBuffers();
+	}
+
+	virtual void OnTransformChanged() override
+	{
+		UpdateQuantizedUniformBuffers();
+	}
+
+	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_DrawStaticElements);
+
+		if (!bStaticDrawPath)
+		{
+			return;
+		}
+
+		// Every LOD goes into the static draw lists, the renderer picks one per view from the screen sizes
+		for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
+		{
+			const FProceduralMeshProxySection* Section = Sections[SectionIdx].Get();
+			if (Section == NULL)
+			{
+				continue;
+			}
+
+			for (int32 LOD = 0; LOD < Section->GetNumLODs(); LOD++)
+			{
+				FMeshBatch Mesh;
+				if (GetMeshBatch(SectionIdx, LOD, Materials[SectionIdx]->GetRenderProxy(false), false, Mesh))
+				{
+					Mesh.CastShadow = true;
+					PDI->DrawMesh(Mesh, LOD == 0 ? FLT_MAX : LODScreenSizes[LOD - 1]);
+				}
+			}
+		}
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_GetDynamicMeshElements);
+
+		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
+
+		FColoredMaterialRenderProxy* WireframeMaterialInstance = NULL;
+		if (bWireframe)
+		{
+			WireframeMaterialInstance = new FColoredMaterialRenderProxy(
+				GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy(IsSelected()) : NULL,
+				FLinearColor(0, 0.5f, 1.f)
+				);
+
+			Collector.RegisterOneFrameMaterialProxy(WireframeMaterialInstance);
+		}
+
+		// All sections of a view share the LOD picked from the bounds of the whole mesh
+		TArray<int32, TInlineAllocator<4>> ViewLODs;
+		for (const FSceneView* View : Views)
+		{
+			ViewLODs.Add(GetLOD(View));
+		}
+
+		for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
+		{
+			const FProceduralMeshProxySection* Section = Sections[SectionIdx].Get();
+			if (Section == NULL)
+			{
+				continue;
+			}
+
+			FMaterialRenderProxy* MaterialProxy = NULL;
+			if(bWireframe)
+			{
+				MaterialProxy = WireframeMaterialInstance;
+			}
+			else
+			{
+				MaterialProxy = Materials[SectionIdx]->GetRenderProxy(IsSelected());
+			}
+
+			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+			{
+				if (VisibilityMap & (1 << ViewIndex))
+				{
+					// Draw the mesh.
+					FMeshBatch& Mesh = Collector.AllocateMesh();
+					if (GetMeshBatch(SectionIdx, FMath::Min(ViewLODs[ViewIndex], Section->GetNumLODs() - 1), MaterialProxy, bWireframe, Mesh))
+					{
+						Mesh.bCanApplyViewModeOverrides = false;
+						Collector.AddMesh(ViewIndex, Mesh);
+					}
+				}
+			}
+		}
+	}
+
+	virtual void DrawDynamicElements(FPrimitiveDrawInterface* PDI, const FSceneView* View)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_DrawDynamicElements);
+
+		const bool bWireframe = AllowDebugViewmodes() && View->Family->EngineShowFlags.Wireframe;
+
+		FColoredMaterialRenderProxy WireframeMaterialInstance(
+			GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy(IsSelected()) : NULL,
+			FLinearColor(0, 0.5f, 1.f)
+			);
+
+		const int32 ViewLOD = GetLOD(View);
+
+		for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
+		{
+			const FProceduralMeshProxySection* Section = Sections[SectionIdx].Get();
+			if (Section == NULL)
+			{
+				continue;
+			}
+
+			FMaterialRenderProxy* MaterialProxy = NULL;
+			if(bWireframe)
+			{
+				MaterialProxy = &WireframeMaterialInstance;
+			}
+			else
+			{
+				MaterialProxy = Materials[SectionIdx]->GetRenderProxy(IsSelected());
+			}
+
+			// Draw the mesh.
+			FMeshBatch Mesh;
+			if (GetMeshBatch(SectionIdx, FMath::Min(ViewLOD, Section->GetNumLODs() - 1), MaterialProxy, bWireframe, Mesh))
+			{
+				PDI->DrawMesh(Mesh);
+			}
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View)
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bShadowRelevance = IsShadowCast(View);
+		// Editor views with selection, wireframe and other debug drawing use the dynamic path like static meshes do
+		if (bStaticDrawPath && !IsRichView(*View->Family))
+		{
+			Result.bStaticRelevance = true;
+		}
+		else
+		{
+			Result.bDynamicRelevance = true;
+		}
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		return Result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !MaterialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint(void) const
+	{
+		return(sizeof(*this) + GetAllocatedSize());
+	}
+
+	/** CPU side only, render data shared with other proxies is counted by each of them */
+	uint32 GetAllocatedSize(void) const
+	{
+		SIZE_T Size = FPrimitiveSceneProxy::GetAllocatedSize() + Sections.GetAllocatedSize() + Materials.GetAllocatedSize() + LODScreenSizes.GetAllocatedSize() +
+			QuantizedUniformBuffers.GetAllocatedSize();
+		for (const FProceduralMeshProxySectionPtr& Section : Sections)
+		{
+			if (Section.IsValid())
+			{
+				Size += sizeof(FProceduralMeshProxySection) + Section->CPUSize;
+			}
+		}
+		return(Size);
+	}
+
+	/** Swap in the freshly built render data of one section, the other sections are left untouched */
+	void SetSection_RenderThread(int32 SectionIndex, const FProceduralMeshProxySectionPtr& NewSection)
+	{
+		check(IsInRenderingThread());
+
+		if (Sections.IsValidIndex(SectionIndex))
+		{
+			Sections[SectionIndex] = NewSection;
+			UpdateQuantizedUniformBuffers();
+		}
+	}
+
+	void UpdateSectionVertices_RenderThread(int32 SectionIndex, const TArray<FProceduralMeshVertex>& NewVertices)
+	{
+		if (Sections.IsValidIndex(SectionIndex) && Sections[SectionIndex].IsValid())
+		{
+			Sections[SectionIndex]->UpdateVertices_RenderThread(NewVertices);
+		}
+	}
+
+	/** Only called for sections the component made unique, shared render data is never written to */
+	void UpdateVertexColors_RenderThread(int32 SectionIndex, int32 Start, const TArray<FColor>& NewColors)
+	{
+		if (Sections.IsValidIndex(SectionIndex) && Sections[SectionIndex].IsValid())
+		{
+			Sections[SectionIndex]->UpdateVertexColors_RenderThread(Start, NewColors);
+		}
+	}
+
+private:
+
+	/** LOD to draw in a view, the last one whose screen size is still above the size of the bounds on screen */
+	int32 GetLOD(const FSceneView* View) const
+	{
+		if (LODScreenSizes.Num() == 0)
+		{
+			return 0;
+		}
+
+		const FBoxSphereBounds& ProxyBounds = GetBounds();
+		const float ScreenSize = ComputeBoundsScreenSize(ProxyBounds.Origin, ProxyBounds.SphereRadius, *View);
+
+		int32 LOD = 0;
+		while (LOD < LODScreenSizes.Num() && ScreenSize < LODScreenSizes[LOD])
+		{
+			LOD++;
+		}
+		return LOD;
+	}
+
+	/** Make sure every section with quantized positions has a primitive uniform buffer with its dequantization in front of the local to world transform.
+	 * Tangents come out the same since the vertex factory takes the scale out of the tangent basis */
+	void UpdateQuantizedUniformBuffers()
+	{
+		check(IsInRenderingThread());
+
+		for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
+		{
+			const FProceduralMeshProxySection* Section = Sections[SectionIdx].Get();
+			if (Section == NULL || !Section->bQuantized)
+			{
+				continue;
+			}
+
+			if (QuantizedUniformBuffers[SectionIdx] == NULL)
+			{
+				QuantizedUniformBuffers[SectionIdx] = new TUniformBuffer<FPrimitiveUniformShaderParameters>();
+			}
+
+			TUniformBuffer<FPrimitiveUniformShaderParameters>* UniformBuffer = QuantizedUniformBuffers[SectionIdx];
+			UniformBuffer->SetContents(GetPrimitiveUniformShaderParameters(
+				Section->GetDequantizationMatrix() * GetLocalToWorld(), GetActorPosition(), GetBounds(), GetLocalBounds(), true, HasDistanceFieldRepresentation(), UseEditorDepthTest()));
+			if (!UniformBuffer->IsInitialized())
+			{
+				UniformBuffer->InitResource();
+			}
+		}
+	}
+
+	/** Everything but the material to draw one LOD of a section, false when that LOD has no triangles */
+	bool GetMeshBatch(int32 SectionIdx, int32 LOD, FMaterialRenderProxy* MaterialProxy, bool bWireframe, FMeshBatch& Mesh) const
+	{
+		const FProceduralMeshProxySection& Section = *Sections[SectionIdx];
+		const int32 NumPrimitives = (Section.LODFirstIndex[LOD + 1] - Section.LODFirstIndex[LOD]) / 3;
+		if (NumPrimitives == 0)
+		{
+			return false;
+		}
+
+		FMeshBatchElement& BatchElement = Mesh.Elements[0];
+		BatchElement.IndexBuffer = &Section.IndexBuffer;
+		Mesh.bWireframe = bWireframe;
+		Mesh.VertexFactory = &Section.GetVertexFactory();
+		Mesh.MaterialRenderProxy = MaterialProxy;
+		// The proxy's own uniform buffer, kept up to date by the renderer instead of being rebuilt for every batch
+		BatchElement.PrimitiveUniformBufferResource = &GetUniformBuffer();
+		if (Section.bQuantized)
+		{
+			// Drawn with the proxy's uniform buffer the int16 positions would come out as garbage
+			check(QuantizedUniformBuffers[SectionIdx] != NULL);
+			BatchElement.PrimitiveUniformBufferResource = QuantizedUniformBuffers[SectionIdx];
+		}
+		BatchElement.FirstIndex = Section.LODFirstIndex[LOD];
+		BatchElement.NumPrimitives = NumPrimitives;
+		BatchElement.MinVertexIndex = 0;
+		BatchElement.MaxVertexIndex = Section.NumRenderVertices - 1;
+		Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+		Mesh.Type = PT_TriangleList;
+		Mesh.DepthPriorityGroup = SDPG_World;
+		Mesh.LODIndex = LOD;
+		return true;
+	}
+
+	/** One entry per component section, NULL when the section has no triangles */
+	TArray<FProceduralMeshProxySectionPtr> Sections;
+
+	/** Material of each section, the render data may be shared with meshes using other materials */
+	TArray<UMaterialInterface*> Materials;
+
+	/** Screen size below which each LOD after the full mesh is drawn */
+	TArray<float> LODScreenSizes;
+
+	/** Primitive uniform buffer of each section with quantized positions, NULL for the others. Only touched on the render thread */
+	TArray<TUniformBuffer<FPrimitiveUniformShaderParameters>*> QuantizedUniformBuffers;
+
+	/** Drawn through DrawStaticElements, sections are never swapped in since the static draw lists point at their buffers */
+	bool bStaticDrawPath;
+
+	FMaterialRelevance MaterialRelevance;
+};
+
+
+/** Worker task running a generator into its own mesh data, which is the back buffer of the section */
+class FProceduralMeshGenerateTask : public FNonAbandonableTask
+{
+public:
+	FProceduralMeshGenerator Generator;
+	FProceduralMeshData MeshData;
+
+	/** LOD chain of the component when the task was started and the LODs simplified from MeshData with it */
+	TArray<FProceduralMeshLODInfo> LODInfos;
+	TArray<TArray<uint32>> LODIndices;
+
+	/** bOptimizeVertexCache of the component when the task was started */
+	bool bOptimize;
+
+	/** Build RenderData with RenderSettings after the LODs (bBuildRenderDataAsync), with its cache key when shared */
+	bool bBuildRenderData;
+	FProceduralMeshRenderSettings RenderSettings;
+	FProceduralMeshProxySectionPtr RenderData;
+
+	/** Result of the validation, done here rather than on the game thread */
+	bool bValid;
+
+	FProceduralMeshGenerateTask()
+		: bOptimize(false)
+		, bBuildRenderData(false)
+		, bValid(false){}
+
+	void DoWork()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_GenerateAsync);
+
+		MeshData.ResetTriangles();
+		MeshData.ResetVertices();
+		Generator(MeshData);
+
+		// Generators may still fill in triangles, convert them here rather than on the game thread
+		bValid = MeshData.ConvertTriangles() && UProceduralMeshComponent::IsValidMeshData(MeshData);
+
+		// So are the optimization and the simplification
+		LODIndices.Empty();
+		RenderData.Reset();
+		if (bValid)
+		{
+			if (bOptimize)
+			{
+				FProceduralMeshOptimizer::Optimize(MeshData);
+			}
+			UProceduralMeshComponent::BuildLODIndices(MeshData, LODInfos, bOptimize, LODIndices);
+
+			// And the render data, the game thread only has to look it up in the geometry cache and start its upload
+			if (bBuildRenderData && MeshData.TrianglesNum() > 0)
+			{
+				RenderData = FProceduralMeshProxySection::Create(MeshData, LODIndices, RenderSettings);
+				if (RenderSettings.bShared)
+				{
+					RenderData->CacheKey = HashRenderData(MeshData, LODIndices, RenderSettings);
+				}
+			}
+		}
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FProceduralMeshGenerateTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+};
+
+/** Asynchronous generation state of one section */
+class FProceduralMeshAsyncGeneration
+{
+public:
+	int32 SectionIndex;
+
+	/** The task is reused, so is the allocation of its back buffer */
+	FAsyncTask<FProceduralMeshGenerateTask> Task;
+
+	/** Latest request made while the task was running */
+	FProceduralMeshGenerator QueuedGenerator;
+	bool bHasQueued;
+
+	explicit FProceduralMeshAsyncGeneration(int32 InSectionIndex)
+		: SectionIndex(InSectionIndex)
+		, bHasQueued(false)
+	{
+	}
+
+	/** RenderSettings is NULL to leave building the render data to the game thread */
+	void Start(const FProceduralMeshGenerator& Generator, const TArray<FProceduralMeshLODInfo>& LODInfos, bool bOptimize, const FProceduralMeshRenderSettings* RenderSettings)
+	{
+		Task.GetTask().Generator = Generator;
+		Task.GetTask().LODInfos = LODInfos;
+		Task.GetTask().bOptimize = bOptimize;
+		Task.GetTask().bBuildRenderData = RenderSettings != NULL;
+		Task.GetTask().RenderSettings = RenderSettings != NULL ? *RenderSettings : FProceduralMeshRenderSettings();
+		Task.StartBackgroundTask();
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+UProceduralMeshComponent::UProceduralMeshComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Only ticks while asynchronous generations, collision cooks or edits are in flight, in the editor as well
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	bTickInEditor = true;
+
+	bFlatShading = false;
+	bDeferCollisionCook = true;
+	bDeferCollisionUpdates = false;
+	bCollisionDirty = false;
+	bCookQueued = false;
+	bUseStaticDrawPath = false;
+	bShareGeometry = true;
+	bUseDynamicBuffers = false;
+	bReleaseRenderData = false;
+	bHalfPrecisionUVs = false;
+	bQuantizePositions = false;
+	bOptimizeVertexCache = false;
+	bBuildRenderDataAsync = false;
+	StaticDrawDelay = 1.f;
+	bMeshEditing = false;
+	bStaticProxy = false;
+	bDynamicProxy = false;
+	LastMeshEditTime = 0.0;
+	LocalBounds.Init();
+
+	SetCollisionProfileName(UCollisionProfile::BlockAllDynamic_ProfileName);
+}
+
+/** Max over a run of indices, four independent lanes the compiler can keep in vector registers */
+static uint32 MaxIndexInRange(const uint32* RESTRICT Indices, int32 Num)
+{
+	uint32 Max0 = 0, Max1 = 0, Max2 = 0, Max3 = 0;
+	int32 Idx = 0;
+	for (; Idx + 4 <= Num; Idx += 4)
+	{
+		Max0 = FMath::Max(Max0, Indices[Idx]);
+		Max1 = FMath::Max(Max1, Indices[Idx + 1]);
+		Max2 = FMath::Max(Max2, Indices[Idx + 2]);
+		Max3 = FMath::Max(Max3, Indices[Idx + 3]);
+	}
+	for (; Idx < Num; Idx++)
+	{
+		Max0 = FMath::Max(Max0, Indices[Idx]);
+	}
+	return FMath::Max(FMath::Max(Max0, Max1), FMath::Max(Max2, Max3));
+}
+
+/** Largest index, large arrays are split into chunks reduced in parallel */
+static uint32 MaxIndex(const TArray<uint32>& Indices)
+{
+	// Below this a single pass is faster than waking up the workers
+	static const int32 MinIndicesPerChunk = 64 * 1024;
+
+	const int32 Num = Indices.Num();
+	const int32 NumChunks = FMath::Min(FMath::Max(Num / MinIndicesPerChunk, 1), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+	if (NumChunks == 1)
+	{
+		return MaxIndexInRange(Indices.GetData(), Num);
+	}
+
+	const int32 ChunkSize = (Num + NumChunks - 1) / NumChunks;
+	TArray<uint32, TInlineAllocator<16>> ChunkMax;
+	ChunkMax.AddZeroed(NumChunks);
+	ParallelFor(NumChunks, [&](int32 Chunk)
+	{
+		const int32 First = Chunk * ChunkSize;
+		ChunkMax[Chunk] = MaxIndexInRange(Indices.GetData() + First, FMath::Min(ChunkSize, Num - First));
+	});
+
+	return MaxIndexInRange(ChunkMax.GetData(), NumChunks);
+}
+
+bool UProceduralMeshComponent::IsValidMeshData(const FProceduralMeshData& Data, bool bTrusted)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Validate);
+
+	const int32 NumVertices = Data.VerteciesNum();
+
+	//ensure that an equal number of positions, colors are present, optional streams are either empty or complete
+	if (Data.VertexColors.Num() != NumVertices ||
+		(Data.VertexNormals.Num() != 0 && Data.VertexNormals.Num() != NumVertices) ||
+		(Data.VertexTangents.Num() != 0 && Data.VertexTangents.Num() != NumVertices) ||
+		Data.Indices.Num() % 3 != 0 ||
+		Data.Triangles.Num() != 0)
+	{
+		return false;
+	}
+
+	for (const FProceduralMeshUVChannel& Channel : Data.UVChannels)
+	{
+		if (Channel.UVs.Num() != 0 && Channel.UVs.Num() != NumVertices)
+		{
+			return false;
+		}
+	}
+
+	//check that all indecies are valid
+	if (!bTrusted && Data.Indices.Num() > 0 && MaxIndex(Data.Indices) >= (uint32)NumVertices)
+	{
+		return false;
+	}
+	// Trusted data is still checked in debug builds
+	checkSlow(!bTrusted || IsValidMeshData(Data));
+
+	return true;
+}
+
+bool UProceduralMeshComponent::SetMeshData(const FProceduralMeshData& Data)
+{
+	return CreateMeshSection(0, Data);
+}
+
+bool UProceduralMeshComponent::SetMeshData(FProceduralMeshData&& Data, bool bTrusted)
+{
+	return CreateMeshSection(0, MoveTemp(Data), bTrusted);
+}
+
+FProceduralMeshData& UProceduralMeshComponent::GetMeshData()
+{
+	return GetMeshSectionData(0);
+}
+
+bool UProceduralMeshComponent::CreateMeshSection(int32 SectionIndex, const FProceduralMeshData& Data)
+{
+	// Triangle based data is converted to the indexed layout on a copy, so it is validated on the result
+	FProceduralMeshData NewData(Data);
+	return CreateMeshSection(SectionIndex, MoveTemp(NewData));
+}
+
+bool UProceduralMeshComponent::CreateMeshSection(int32 SectionIndex, FProceduralMeshData&& Data, bool bTrusted)
+{
+	if (SectionIndex < 0)
+	{
+		return false;
+	}
+
+	// Converted in place, a failed call leaves the caller's data converted but otherwise untouched
+	if (!Data.ConvertTriangles() || !IsValidMeshData(Data, bTrusted))
+	{
+		return false;
+	}
+
+	if (bOptimizeVertexCache)
+	{
+		FProceduralMeshOptimizer::Optimize(Data);
+	}
+
+	const bool bNewSection = SectionIndex >= Sections.Num();
+	if (bNewSection)
+	{
+		Sections.SetNum(SectionIndex + 1);
+	}
+
+	// Frees the previous data right away rather than handing it back to the caller
+	Sections[SectionIndex].MeshData = MoveTemp(Data);
+	Sections[SectionIndex].bVerticesRenumbered = bOptimizeVertexCache;
+
+	BuildSectionLODs(SectionIndex);
+	SectionChanged(SectionIndex, bNewSection);
+
+	return true;
+}
+
+bool UProceduralMeshComponent::UpdateMeshSection(int32 SectionIndex, bool bPositionsChanged)
+{
+	if (!Sections.IsValidIndex(SectionIndex) || !Sections[SectionIndex].MeshData.ConvertTriangles() || !IsValidMeshData(Sections[SectionIndex].MeshData))
+	{
+		return false;
+	}
+
+	if (bPositionsChanged)
+	{
+		// Positions were edited in place, the generator bounds and the LODs no longer hold
+		Sections[SectionIndex].MeshData.Bounds.Init();
+		BuildSectionLODs(SectionIndex);
+	}
+
+	SectionChanged(SectionIndex, false, bPositionsChanged);
+
+	return true;
+}
+
+bool UProceduralMeshComponent::UpdateMeshSectionVertices(int32 SectionIndex)
+{
+	if (!bUseDynamicBuffers || SceneProxy == NULL || !bDynamicProxy || !Sections.IsValidIndex(SectionIndex))
+	{
+		if (bUseDynamicBuffers && SceneProxy != NULL && !bDynamicProxy)
+		{
+			// bUseDynamicBuffers was set after the proxy was created
+			MarkRenderStateDirty();
+		}
+		return UpdateMeshSection(SectionIndex);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_UpdateVertices);
+
+	// The topology is the one the proxy was built with, only the vertex streams need checking
+	FProceduralMeshSection& Section = Sections[SectionIndex];
+	if (!IsValidMeshData(Section.MeshData, true))
+	{
+		return false;
+	}
+
+	Section.MeshData.Bounds.Init();
+	Section.UpdateLocalBox();
+	UpdateLocalBounds();
+	UpdateBounds();
+
+	// Not cooked for every frame of a deformation, UpdateCollision catches up when needed
+	bCollisionDirty = true;
+
+	TArray<FProceduralMeshVertex> NewVertices;
+	if (bFlatShading)
+	{
+		TArray<uint32> LODChainIndices;
+		TArray<int32> LODFirstIndex;
+		TArray<int32> FirstRenderVertex;
+		const TArray<uint32>& Indices = FProceduralMeshProxySection::GetIndexChain(Section.MeshData, Section.LODIndices, LODChainIndices, LODFirstIndex);
+		FProceduralMeshProxySection::CountRenderVertices(Indices, Section.MeshData.VerteciesNum(), FirstRenderVertex);
+		FProceduralMeshProxySection::BuildVertices(Section.MeshData, Indices, LODFirstIndex[1], FirstRenderVertex, NewVertices);
+	}
+	else
+	{
+		FProceduralMeshProxySection::BuildVertices(Section.MeshData, Section.MeshData.Indices, Section.MeshData.Indices.Num(), TArray<int32>(), NewVertices);
+	}
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+		FProceduralMeshUpdateSectionVertices,
+		FProceduralMeshSceneProxy*, Proxy, (FProceduralMeshSceneProxy*)SceneProxy,
+		int32, SectionIndex, SectionIndex,
+		TArray<FProceduralMeshVertex>, NewVertices, NewVertices,
+	{
+		Proxy->UpdateSectionVertices_RenderThread(SectionIndex, NewVertices);
+	});
+
+	// Bounds changed, this does not recreate the proxy
+	MarkRenderTransformDirty();
+
+	return true;
+}
+
+void UProceduralMeshComponent::ClearMeshSection(int32 SectionIndex)
+{
+	if (Sections.IsValidIndex(SectionIndex))
+	{
+		Sections[SectionIndex].Reset();
+
+		SectionChanged(SectionIndex, false);
+	}
+}
+
+void UProceduralMeshComponent::ClearAllMeshSections()
+{
+	Sections.Empty();
+
+	LocalBounds.Init();
+	UpdateBounds();
+
+	UpdateCollision();
+
+	// Need to recreate scene proxy to send it over
+	MarkRenderStateDirty();
+}
+
+int32 UProceduralMeshComponent::GetNumSections() const
+{
+	return Sections.Num();
+}
+
+FProceduralMeshData& UProceduralMeshComponent::GetMeshSectionData(int32 SectionIndex)
+{
+	check(SectionIndex >= 0);
+
+	if (SectionIndex >= Sections.Num())
+	{
+		Sections.SetNum(SectionIndex + 1);
+	}
+
+	return Sections[SectionIndex].MeshData;
+}
+
+void UProceduralMeshComponent::SectionChanged(int32 SectionIndex, bool bNewSection, bool bPositionsChanged, const FProceduralMeshProxySectionPtr& PrebuiltSection)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_SectionChanged);
+#if STATS
+	// Charges the time to this component in stat captures, to find the one causing a spike
+	FScopeCycleCounterUObject ComponentScope(this);
+#endif
+
+	if (bPositionsChanged)
+	{
+		Sections[SectionIndex].UpdateLocalBox();
+		UpdateLocalBounds();
+		UpdateBounds();
+
+		if (bDeferCollisionUpdates)
+		{
+			bCollisionDirty = true;
+		}
+		else
+		{
+			UpdateCollision();
+		}
+	}
+
+	if (SceneProxy != NULL && bUseStaticDrawPath)
+	{
+		// Stay on the dynamic path while the mesh keeps changing
+		bMeshEditing = true;
+		LastMeshEditTime = FPlatformTime::Seconds();
+		SetComponentTickEnabled(true);
+	}
+
+	if (bNewSection || SceneProxy == NULL || bStaticProxy)
+	{
+		// The set of sections (and materials) changed, or the static draw lists point at the old buffers: need to recreate scene proxy to send it over
+		MarkRenderStateDirty();
+		return;
+	}
+
+	// Only this section's buffers are rebuilt and swapped into the existing proxy
+	FProceduralMeshProxySectionPtr NewSection = CreateProxySection(SectionIndex, PrebuiltSection);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+		FProceduralMeshSetSection,
+		FProceduralMeshSceneProxy*, Proxy, (FProceduralMeshSceneProxy*)SceneProxy,
+		int32, SectionIndex, SectionIndex,
+		FProceduralMeshProxySectionPtr, NewSection, NewSection,
+	{
+		Proxy->SetSection_RenderThread(SectionIndex, NewSection);
+	});
+
+	// Bounds may have changed, this does not recreate the proxy
+	MarkRenderTransformDirty();
+}
+
+/** Render data by the hash of everything it is built from, only used on the game thread. Entries expire with their last proxy */
+static TMap<FSHAHash, TWeakPtr<FProceduralMeshProxySection, ESPMode::ThreadSafe>> GProceduralMeshGeometryCache;
+
+FProceduralMeshRenderSettings UProceduralMeshComponent::GetRenderSettings(int32 SectionIndex) const
+{
+	const bool bUniqueRenderData = Sections.IsValidIndex(SectionIndex) && Sections[SectionIndex].bUniqueRenderData;
+
+	FProceduralMeshRenderSettings Settings;
+	Settings.bWeld = !bFlatShading;
+	Settings.bDynamic = bUseDynamicBuffers;
+	Settings.bReleaseCPUData = bReleaseRenderData;
+	Settings.bHalfPrecisionUVs = bHalfPrecisionUVs;
+	// The velocity pass of movable meshes transforms positions with the previous local to world as is, quantized ones would need their dequantization there too
+	Settings.bQuantizePositions = bQuantizePositions && Mobility != EComponentMobility::Movable;
+	// Dynamic render data is rewritten all the time, it is never shared
+	Settings.bShared = bShareGeometry && !bUniqueRenderData && !bUseDynamicBuffers;
+	return Settings;
+}
+
+FProceduralMeshProxySectionPtr UProceduralMeshComponent::CreateProxySection(int32 SectionIndex, const FProceduralMeshProxySectionPtr& PrebuiltSection)
+{
+	FProceduralMeshSection& Section = Sections[SectionIndex];
+	Section.RenderDataSize = 0;
+	Section.bSharedRenderData = false;
+	Section.RenderData.Reset();
+	if (Section.MeshData.TrianglesNum() == 0)
+	{
+		return FProceduralMeshProxySectionPtr();
+	}
+
+	const FProceduralMeshRenderSettings Settings = GetRenderSettings(SectionIndex);
+
+	// Built on a generation worker from the mesh data just swapped in, stale if the settings changed meanwhile
+	const bool bPrebuilt = PrebuiltSection.IsValid() && PrebuiltSection->Settings == Settings;
+
+	if (!Settings.bShared)
+	{
+		FProceduralMeshProxySectionPtr NewSection = bPrebuilt ? PrebuiltSection : FProceduralMeshProxySection::Create(Section.MeshData, Section.LODIndices, Settings);
+		NewSection->InitResources();
+		Section.RenderDataSize = NewSection->CPUSize + NewSection->GPUSize;
+		Section.RenderData = NewSection;
+		return NewSection;
+	}
+
+	Section.bSharedRenderData = true;
+
+	// Identical sections of any component share one set of buffers and one vertex factory
+	const FSHAHash Key = bPrebuilt ? PrebuiltSection->CacheKey : HashRenderData(Section.MeshData, Section.LODIndices, Settings);
+	TWeakPtr<FProceduralMeshProxySection, ESPMode::ThreadSafe>* Cached = GProceduralMeshGeometryCache.Find(Key);
+	if (Cached != NULL)
+	{
+		FProceduralMeshProxySectionPtr Shared = Cached->Pin();
+		if (Shared.IsValid())
+		{
+			INC_DWORD_STAT(STAT_ProceduralMesh_SectionsShared);
+			Shared->bCacheHit = true;
+			Section.RenderDataSize = Shared->CPUSize + Shared->GPUSize;
+			Section.RenderData = Shared;
+			return Shared;
+		}
+	}
+
+	FProceduralMeshProxySectionPtr NewSection = bPrebuilt ? PrebuiltSection : FProceduralMeshProxySection::Create(Section.MeshData, Section.LODIndices, Settings);
+	NewSection->CacheKey = Key;
+	NewSection->InitResources();
+	Section.RenderDataSize = NewSection->CPUSize + NewSection->GPUSize;
+	Section.RenderData = NewSection;
 
-int32 FProceduralMeshData::TrianglesNum() const
-{
-	return Triangles.Num();
+	// Drop the expired entries whenever the cache has doubled since the last time
+	static int32 NumEntriesAfterCleanup = 0;
+	if (GProceduralMeshGeometryCache.Num() >= FMath::Max(2 * NumEntriesAfterCleanup, 64))
+	{
+		for (auto It = GProceduralMeshGeometryCache.CreateIterator(); It; ++It)
+		{
+			if (!It.Value().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		NumEntriesAfterCleanup = GProceduralMeshGeometryCache.Num();
+	}
+
+	GProceduralMeshGeometryCache.Add(Key, NewSection);
+	return NewSection;
 }
 
-int32 FProceduralMeshData::VerteciesNum() const
+void UProceduralMeshComponent::BuildSectionLODs(int32 SectionIndex)
 {
-	return VertexPositions.Num();
+	BuildLODIndices(Sections[SectionIndex].MeshData, LODs, bOptimizeVertexCache, Sections[SectionIndex].LODIndices);
 }
 
-
-/** Vertex Buffer */
-class FProceduralMeshVertexBuffer : public FVertexBuffer
+void UProceduralMeshComponent::BuildLODIndices(const FProceduralMeshData& Data, const TArray<FProceduralMeshLODInfo>& LODInfos, bool bOptimize, TArray<TArray<uint32>>& OutLODIndices)
 {
-public:
-	TArray<FDynamicMeshVertex> Vertices;
+	FProceduralMeshSimplifier::BuildLODIndices(Data, LODInfos, OutLODIndices);
 
-	virtual void InitRHI() override
+	// The vertices are shared with the full mesh and already in its order, only the triangles of each LOD are reordered
+	for (int32 LOD = 0; bOptimize && LOD < OutLODIndices.Num(); LOD++)
 	{
-		FRHIResourceCreateInfo CreateInfo;
-		VertexBufferRHI = RHICreateVertexBuffer(Vertices.Num() * sizeof(FDynamicMeshVertex), BUF_Static, CreateInfo);
-		// Copy the vertex data into the vertex buffer.
-		void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, Vertices.Num() * sizeof(FDynamicMeshVertex), RLM_WriteOnly);
-		FMemory::Memcpy(VertexBufferData, Vertices.GetData(), Vertices.Num() * sizeof(FDynamicMeshVertex));
-		RHIUnlockVertexBuffer(VertexBufferRHI);
+		FProceduralMeshOptimizer::OptimizeTriangleOrder(Data.VertexPositions, OutLODIndices[LOD]);
 	}
-};
+}
 
-/** Index Buffer */
-class FProceduralMeshIndexBuffer : public FIndexBuffer
+void UProceduralMeshComponent::SetLODs(const TArray<FProceduralMeshLODInfo>& NewLODs)
 {
-public:
-	TArray<int32> Indices;
+	LODs = NewLODs;
 
-	virtual void InitRHI() override
+	for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
 	{
-		FRHIResourceCreateInfo CreateInfo;
-		IndexBufferRHI = RHICreateIndexBuffer(sizeof(int32), Indices.Num() * sizeof(int32), BUF_Static, CreateInfo);
-		// Write the indices to the index buffer.
-		void* Buffer = RHILockIndexBuffer(IndexBufferRHI, 0, Indices.Num() * sizeof(int32), RLM_WriteOnly);
-		FMemory::Memcpy(Buffer, Indices.GetData(), Indices.Num() * sizeof(int32));
-		RHIUnlockIndexBuffer(IndexBufferRHI);
+		BuildSectionLODs(SectionIdx);
 	}
-};
 
-/** Vertex Factory */
-class FProceduralMeshVertexFactory : public FLocalVertexFactory
+	// Need to recreate scene proxy to send the new index buffers and screen sizes over
+	MarkRenderStateDirty();
+}
+
+void UProceduralMeshComponent::PostLoad()
 {
-public:
-	FProceduralMeshVertexFactory()
-	{
-	}
+	Super::PostLoad();
 
-	/** Initialization */
-	void Init(const FProceduralMeshVertexBuffer* VertexBuffer)
+	// LODs are not saved with the sections
+	for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
 	{
-		// Commented out to enable building light of a level (but no backing is done for the procedural mesh itself)
-		//check(!IsInRenderingThread());
-
-		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
-			InitProceduralMeshVertexFactory,
-			FProceduralMeshVertexFactory*, VertexFactory, this,
-			const FProceduralMeshVertexBuffer*, VertexBuffer, VertexBuffer,
-		{
-			// Initialize the vertex factory's stream components.
-			DataType NewData;
-			NewData.PositionComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FDynamicMeshVertex,Position,VET_Float3);
-			NewData.TextureCoordinates.Add(
-				FVertexStreamComponent(VertexBuffer,STRUCT_OFFSET(FDynamicMeshVertex,TextureCoordinate),sizeof(FDynamicMeshVertex),VET_Float2)
-				);
-			NewData.TangentBasisComponents[0] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FDynamicMeshVertex,TangentX,VET_PackedNormal);
-			NewData.TangentBasisComponents[1] = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer,FDynamicMeshVertex,TangentZ,VET_PackedNormal);
-			NewData.ColorComponent = STRUCTMEMBER_VERTEXSTREAMCOMPONENT(VertexBuffer, FDynamicMeshVertex, Color, VET_Color);
-			VertexFactory->SetData(NewData);
-		});
+		BuildSectionLODs(SectionIdx);
 	}
-};
-
-
+}
 
-/** Scene proxy */
-class FProceduralMeshSceneProxy : public FPrimitiveSceneProxy
+SIZE_T UProceduralMeshComponent::GetResourceSize(EResourceSizeMode::Type Mode)
 {
-public:
+	SIZE_T ResSize = Super::GetResourceSize(Mode) + Sections.GetAllocatedSize();
 
-	FProceduralMeshSceneProxy(UProceduralMeshComponent* Component)
-		: FPrimitiveSceneProxy(Component)
-		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+	for (const FProceduralMeshSection& Section : Sections)
 	{
+		ResSize += Section.MeshData.GetAllocatedSize() + Section.LODIndices.GetAllocatedSize();
+		for (const TArray<uint32>& LOD : Section.LODIndices)
+		{
+			ResSize += LOD.GetAllocatedSize();
+		}
 
-		// Add each triangle to the vertex/index buffer
-		for (int TriIdx = 0; TriIdx<Component->MeshData.TrianglesNum(); TriIdx++)
+		// Render data shared with other components only counts towards the inclusive size
+		if (!Section.bSharedRenderData || Mode == EResourceSizeMode::Inclusive)
 		{
-			FProceduralMeshTriangle& Tri = Component->MeshData.Triangles[TriIdx];
-			TArray<FVector>& VertexPositions = Component->MeshData.VertexPositions;
-			TArray<FColor>& VertexColors = Component->MeshData.VertexColors;
+			ResSize += Section.RenderDataSize;
+		}
+	}
 
+	return ResSize;
+}
 
-			const FVector Edge01 = (VertexPositions[Tri.Vertex1] - VertexPositions[Tri.Vertex0]);
-			const FVector Edge02 = (VertexPositions[Tri.Vertex2] - VertexPositions[Tri.Vertex0]);
+#ifdef WITH_EDITOR
+void UProceduralMeshComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	const FName PropertyName = PropertyChangedEvent.MemberProperty != NULL ? PropertyChangedEvent.MemberProperty->GetFName() : NAME_None;
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UProceduralMeshComponent, LODs))
+	{
+		SetLODs(LODs);
+	}
 
-			const FVector TangentX = Edge01.GetSafeNormal();
-			const FVector TangentZ = (Edge02 ^ Edge01).GetSafeNormal();
-			const FVector TangentY = (TangentX ^ TangentZ).GetSafeNormal();
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif
 
-			FDynamicMeshVertex Vert0;
-			Vert0.Position = VertexPositions[Tri.Vertex0];
-			Vert0.Color = VertexColors[Tri.Vertex0];
-			Vert0.SetTangents(TangentX, TangentY, TangentZ);
-			Vert0.TextureCoordinate.Set(Tri.UV0.U, Tri.UV0.V);
-			int32 VIndex = VertexBuffer.Vertices.Add(Vert0);
-			IndexBuffer.Indices.Add(VIndex);
+void UProceduralMeshComponent::GenerateMeshSectionAsync(int32 SectionIndex, const FProceduralMeshGenerator& Generator)
+{
+	if (SectionIndex < 0)
+	{
+		return;
+	}
 
-			FDynamicMeshVertex Vert1;
-			Vert1.Position = VertexPositions[Tri.Vertex1];
-			Vert1.Color = VertexColors[Tri.Vertex1];
-			Vert1.SetTangents(TangentX, TangentY, TangentZ);
-			Vert1.TextureCoordinate.Set(Tri.UV1.U, Tri.UV1.V);
-			VIndex = VertexBuffer.Vertices.Add(Vert1);
-			IndexBuffer.Indices.Add(VIndex);
+	// Nothing will poll the task, do it right away
+	if (!IsRegistered() || GetWorld() == NULL)
+	{
+		FProceduralMeshData Data;
+		Generator(Data);
+		CreateMeshSection(SectionIndex, MoveTemp(Data));
+		OnMeshGenerated.Broadcast(SectionIndex);
+		return;
+	}
 
-			FDynamicMeshVertex Vert2;
-			Vert2.Position = VertexPositions[Tri.Vertex2];
-			Vert2.Color = VertexColors[Tri.Vertex2];
-			Vert2.SetTangents(TangentX, TangentY, TangentZ);
-			Vert2.TextureCoordinate.Set(Tri.UV2.U, Tri.UV2.V);
-			VIndex = VertexBuffer.Vertices.Add(Vert2);
-			IndexBuffer.Indices.Add(VIndex);
+	for (FProceduralMeshAsyncGeneration* Generation : AsyncGenerations)
+	{
+		if (Generation->SectionIndex == SectionIndex)
+		{
+			// Still running (or finished but not swapped in yet), the next poll starts it
+			Generation->QueuedGenerator = Generator;
+			Generation->bHasQueued = true;
+			return;
 		}
+	}
 
-		// Init vertex factory
-		VertexFactory.Init(&VertexBuffer);
+	FProceduralMeshAsyncGeneration* Generation = new FProceduralMeshAsyncGeneration(SectionIndex);
+	AsyncGenerations.Add(Generation);
+	const FProceduralMeshRenderSettings RenderSettings = GetRenderSettings(SectionIndex);
+	Generation->Start(Generator, LODs, bOptimizeVertexCache, bBuildRenderDataAsync ? &RenderSettings : NULL);
 
-		// Enqueue initialization of render resource
-		BeginInitResource(&VertexBuffer);
-		BeginInitResource(&IndexBuffer);
-		BeginInitResource(&VertexFactory);
+	SetComponentTickEnabled(true);
+}
 
-		// Grab material
-		Material = Component->GetMaterial(0);
-		if(Material == NULL)
+bool UProceduralMeshComponent::IsGeneratingMeshSection(int32 SectionIndex) const
+{
+	for (const FProceduralMeshAsyncGeneration* Generation : AsyncGenerations)
+	{
+		if (Generation->SectionIndex == SectionIndex)
 		{
-			Material = UMaterial::GetDefaultMaterial(MD_Surface);
+			return true;
 		}
 	}
+	return false;
+}
 
-	virtual ~FProceduralMeshSceneProxy()
+void UProceduralMeshComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	PollAsyncGenerations();
+	PollQueuedCook();
+
+	if (bMeshEditing && FPlatformTime::Seconds() - LastMeshEditTime >= StaticDrawDelay)
 	{
-		VertexBuffer.ReleaseResource();
-		IndexBuffer.ReleaseResource();
-		VertexFactory.ReleaseResource();
+		// Left alone long enough, go back to the static path
+		bMeshEditing = false;
+		MarkRenderStateDirty();
 	}
 
-    virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	if (AsyncGenerations.Num() == 0 && !bCookQueued && !bMeshEditing)
 	{
-		QUICK_SCOPE_CYCLE_COUNTER( STAT_ProceduralMeshSceneProxy_GetDynamicMeshElements );
-
-		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
-
-		auto WireframeMaterialInstance = new FColoredMaterialRenderProxy(
-			GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy(IsSelected()) : NULL,
-			FLinearColor(0, 0.5f, 1.f)
-			);
+		SetComponentTickEnabled(false);
+	}
+}
 
-		Collector.RegisterOneFrameMaterialProxy(WireframeMaterialInstance);
+void UProceduralMeshComponent::PollAsyncGenerations()
+{
+	TArray<int32, TInlineAllocator<4>> FinishedSections;
 
-		FMaterialRenderProxy* MaterialProxy = NULL;
-		if(bWireframe)
-		{
-			MaterialProxy = WireframeMaterialInstance;
-		}
-		else
+	for (int32 GenIdx = AsyncGenerations.Num() - 1; GenIdx >= 0; GenIdx--)
+	{
+		FProceduralMeshAsyncGeneration* Generation = AsyncGenerations[GenIdx];
+		if (!Generation->Task.IsDone())
 		{
-			MaterialProxy = Material->GetRenderProxy(IsSelected());
+			continue;
 		}
 
-		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+		// Swap the back buffer in, the old front buffer becomes the next back buffer
+		FProceduralMeshData& BackBuffer = Generation->Task.GetTask().MeshData;
+		const int32 SectionIndex = Generation->SectionIndex;
+		if (Generation->Task.GetTask().bValid)
 		{
-			if (VisibilityMap & (1 << ViewIndex))
+			const bool bNewSection = SectionIndex >= Sections.Num();
+			if (bNewSection)
 			{
-				const FSceneView* View = Views[ViewIndex];
-				// Draw the mesh.
-				FMeshBatch& Mesh = Collector.AllocateMesh();
-				FMeshBatchElement& BatchElement = Mesh.Elements[0];
-				BatchElement.IndexBuffer = &IndexBuffer;
-				Mesh.bWireframe = bWireframe;
-				Mesh.VertexFactory = &VertexFactory;
-				Mesh.MaterialRenderProxy = MaterialProxy;
-				BatchElement.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
-				BatchElement.FirstIndex = 0;
-				BatchElement.NumPrimitives = IndexBuffer.Indices.Num() / 3;
-				BatchElement.MinVertexIndex = 0;
-				BatchElement.MaxVertexIndex = VertexBuffer.Vertices.Num() - 1;
-				Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
-				Mesh.Type = PT_TriangleList;
-				Mesh.DepthPriorityGroup = SDPG_World;
-				Mesh.bCanApplyViewModeOverrides = false;
-				Collector.AddMesh(ViewIndex, Mesh);
+				Sections.SetNum(SectionIndex + 1);
 			}
-		}
-	}
-
-	virtual void DrawDynamicElements(FPrimitiveDrawInterface* PDI, const FSceneView* View)
-	{
-		QUICK_SCOPE_CYCLE_COUNTER(STAT_ProceduralMeshSceneProxy_DrawDynamicElements);
-
-		const bool bWireframe = AllowDebugViewmodes() && View->Family->EngineShowFlags.Wireframe;
 
-		FColoredMaterialRenderProxy WireframeMaterialInstance(
-			GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy(IsSelected()) : NULL,
-			FLinearColor(0, 0.5f, 1.f)
-			);
+			Exchange(Sections[SectionIndex].MeshData, BackBuffer);
+			Sections[SectionIndex].bVerticesRenumbered = Generation->Task.GetTask().bOptimize;
+			FProceduralMeshProxySectionPtr RenderData;
+			if (Generation->Task.GetTask().LODInfos == LODs && Generation->Task.GetTask().bOptimize == bOptimizeVertexCache)
+			{
+				Exchange(Sections[SectionIndex].LODIndices, Generation->Task.GetTask().LODIndices);
+				Exchange(RenderData, Generation->Task.GetTask().RenderData);
+			}
+			else
+			{
+				// The LOD chain (or its optimization) was changed while generating, so is the render data built with it
+				BuildSectionLODs(SectionIndex);
+				Generation->Task.GetTask().RenderData.Reset();
+			}
+			SectionChanged(SectionIndex, bNewSection, true, RenderData);
+			FinishedSections.Add(SectionIndex);
+		}
 
-		FMaterialRenderProxy* MaterialProxy = NULL;
-		if(bWireframe)
+		if (Generation->bHasQueued)
 		{
-			MaterialProxy = &WireframeMaterialInstance;
+			Generation->bHasQueued = false;
+			const FProceduralMeshRenderSettings RenderSettings = GetRenderSettings(SectionIndex);
+			Generation->Start(Generation->QueuedGenerator, LODs, bOptimizeVertexCache, bBuildRenderDataAsync ? &RenderSettings : NULL);
+			Generation->QueuedGenerator = FProceduralMeshGenerator();
 		}
 		else
 		{
-			MaterialProxy = Material->GetRenderProxy(IsSelected());
+			delete Generation;
+			AsyncGenerations.RemoveAtSwap(GenIdx);
 		}
-
-		// Draw the mesh.
-		FMeshBatch Mesh;
-		FMeshBatchElement& BatchElement = Mesh.Elements[0];
-		BatchElement.IndexBuffer = &IndexBuffer;
-		Mesh.bWireframe = bWireframe;
-		Mesh.VertexFactory = &VertexFactory;
-		Mesh.MaterialRenderProxy = MaterialProxy;
-		BatchElement.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
-		BatchElement.FirstIndex = 0;
-		BatchElement.NumPrimitives = IndexBuffer.Indices.Num() / 3;
-		BatchElement.MinVertexIndex = 0;
-		BatchElement.MaxVertexIndex = VertexBuffer.Vertices.Num() - 1;
-		Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
-		Mesh.Type = PT_TriangleList;
-		Mesh.DepthPriorityGroup = SDPG_World;
-		PDI->DrawMesh(Mesh);
 	}
 
-	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View)
+	// Broadcast last, listeners may well request another generation
+	for (int32 SectionIndex : FinishedSections)
 	{
-		FPrimitiveViewRelevance Result;
-		Result.bDrawRelevance = IsShown(View);
-		Result.bShadowRelevance = IsShadowCast(View);
-		Result.bDynamicRelevance = true;
-		MaterialRelevance.SetPrimitiveViewRelevance(Result);
-		return Result;
+		OnMeshGenerated.Broadcast(SectionIndex);
 	}
+}
 
-	virtual bool CanBeOccluded() const override
+void UProceduralMeshComponent::BeginDestroy()
+{
+	for (FProceduralMeshAsyncGeneration* Generation : AsyncGenerations)
 	{
-		return !MaterialRelevance.bDisableDepthTest;
+		Generation->Task.EnsureCompletion();
+		delete Generation;
 	}
+	AsyncGenerations.Empty();
+
+	Super::BeginDestroy();
+}
 
-		virtual uint32 GetMemoryFootprint(void) const
+void UProceduralMeshComponent::SetFlatShading(bool bNewFlatShading)
+{
+	if (bFlatShading != bNewFlatShading)
 	{
-		return(sizeof(*this) + GetAllocatedSize());
+		bFlatShading = bNewFlatShading;
+
+		// Need to recreate scene proxy to rebuild the render vertices
+		MarkRenderStateDirty();
 	}
+}
 
-	uint32 GetAllocatedSize(void) const
+void UProceduralMeshComponent::UpdateVertexColors(int32 Start, int32 Count, int32 SectionIndex)
+{
+	if (!Sections.IsValidIndex(SectionIndex))
 	{
-		return(FPrimitiveSceneProxy::GetAllocatedSize());
+		return;
 	}
 
-private:
-
-	UMaterialInterface* Material;
-	FProceduralMeshVertexBuffer VertexBuffer;
-	FProceduralMeshIndexBuffer IndexBuffer;
-	FProceduralMeshVertexFactory VertexFactory;
-
-	FMaterialRelevance MaterialRelevance;
-};
-
-
-//////////////////////////////////////////////////////////////////////////
+	const TArray<FColor>& VertexColors = Sections[SectionIndex].MeshData.VertexColors;
+	if (Count <= 0 || Start < 0 || Start + Count > VertexColors.Num())
+	{
+		return;
+	}
 
-UProceduralMeshComponent::UProceduralMeshComponent(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
-{
-	PrimaryComponentTick.bCanEverTick = false;
+	// The range still gets uploaded, but it is unlikely to be the vertices the caller generated there
+	ensureMsg(!Sections[SectionIndex].bVerticesRenumbered, TEXT("UpdateVertexColors on a section renumbered by bOptimizeVertexCache"));
 
-	SetCollisionProfileName(UCollisionProfile::BlockAllDynamic_ProfileName);
-}
+	// No proxy yet, the colors will be picked up when it is created
+	if (SceneProxy == NULL)
+	{
+		return;
+	}
 
-bool UProceduralMeshComponent::SetMeshData(const FProceduralMeshData& Data)
-{
-	//ensure that an equal number of positions, colors are present
-	if (Data.VertexPositions.Num() == Data.VertexColors.Num())
+	if (bShareGeometry && !Sections[SectionIndex].bUniqueRenderData)
 	{
-		//check that all indecies in the triangle array are valid
-		for (auto Triangle : Data.Triangles)
+		// The section gets render data of its own from now on
+		Sections[SectionIndex].bUniqueRenderData = true;
+
+		const FProceduralMeshProxySectionPtr RenderData = Sections[SectionIndex].RenderData.Pin();
+		if (RenderData.IsValid() && RenderData->bCacheHit)
 		{
-			if (!(Data.VertexColors.IsValidIndex(Triangle.Vertex0) &&
-				Data.VertexColors.IsValidIndex(Triangle.Vertex1) &&
-				Data.VertexColors.IsValidIndex(Triangle.Vertex2)))
-			{
-				return false;
-			}
+			// Other meshes are drawing these buffers
+			SectionChanged(SectionIndex, false, false);
+			return;
 		}
 
-		MeshData = Data;
-
-		UpdateCollision();
-
-		MarkRenderStateDirty();
-
-		return true;
+		// Only this section draws them, they just leave the cache before their colors are written in place
+		if (RenderData.IsValid() && GProceduralMeshGeometryCache.FindRef(RenderData->CacheKey).Pin() == RenderData)
+		{
+			GProceduralMeshGeometryCache.Remove(RenderData->CacheKey);
+		}
+		Sections[SectionIndex].bSharedRenderData = false;
 	}
 
-	return false;
-}
+	TArray<FColor> NewColors;
+	NewColors.Append(&VertexColors[Start], Count);
 
-FProceduralMeshData& UProceduralMeshComponent::GetMeshData()
-{
-	return MeshData;
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+		FProceduralMeshUpdateVertexColors,
+		FProceduralMeshSceneProxy*, Proxy, (FProceduralMeshSceneProxy*)SceneProxy,
+		int32, SectionIndex, SectionIndex,
+		int32, Start, Start,
+		TArray<FColor>, NewColors, NewColors,
+	{
+		Proxy->UpdateVertexColors_RenderThread(SectionIndex, Start, NewColors);
+	});
 }
 
 //bool UProceduralMeshComponent::SetProceduralMeshTriangles(const TArray<FProceduralMeshTriangle>& Triangles)
@@ -360,7 +2394,14 @@ FProceduralMeshData& UProceduralMeshComponent::GetMeshData()
 
 void  UProceduralMeshComponent::ClearProceduralMeshTriangles()
 {
-	MeshData.ResetTriangles();
+	for (FProceduralMeshSection& Section : Sections)
+	{
+		Section.MeshData.ResetTriangles();
+		Section.LODIndices.Empty();
+		Section.UpdateLocalBox();
+	}
+	UpdateLocalBounds();
+	UpdateBounds();
 
 	// Need to recreate scene proxy to send it over
 	MarkRenderStateDirty();
@@ -369,67 +2410,52 @@ void  UProceduralMeshComponent::ClearProceduralMeshTriangles()
 
 FPrimitiveSceneProxy* UProceduralMeshComponent::CreateSceneProxy()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_CreateSceneProxy);
+#if STATS
+	FScopeCycleCounterUObject ComponentScope(this);
+#endif
+
 	FPrimitiveSceneProxy* Proxy = NULL;
 	// Only if have enough triangles
-	if(MeshData.TrianglesNum() > 0)
+	for (const FProceduralMeshSection& Section : Sections)
 	{
-		Proxy = new FProceduralMeshSceneProxy(this);
+		if (Section.MeshData.TrianglesNum() > 0)
+		{
+			// The vertex factory of a dynamic section changes with every update, which static draw lists cannot follow
+			bStaticProxy = bUseStaticDrawPath && !bMeshEditing && !bUseDynamicBuffers;
+			bDynamicProxy = bUseDynamicBuffers;
+			Proxy = new FProceduralMeshSceneProxy(this);
+			break;
+		}
 	}
 	return Proxy;
 }
 
 int32 UProceduralMeshComponent::GetNumMaterials() const
 {
-	return 1;
+	return Sections.Num();
 }
 
 
-FBoxSphereBounds UProceduralMeshComponent::CalcBounds(const FTransform & LocalToWorld) const
+void UProceduralMeshComponent::UpdateLocalBounds()
 {
-	// Only if have enough triangles
-	if (MeshData.TrianglesNum() > 0)
-	{
-		// Minimum Vector: It's set to the first vertex's position initially (NULL == FVector::ZeroVector might be required and a known vertex vector has intrinsically valid values)
-		FVector vecMin = MeshData.VertexPositions[MeshData.Triangles[0].Vertex0];
-
-		// Maximum Vector: It's set to the first vertex's position initially (NULL == FVector::ZeroVector might be required and a known vertex vector has intrinsically valid values)
-		FVector vecMax = MeshData.VertexPositions[MeshData.Triangles[0].Vertex0];
-
-		// Get maximum and minimum X, Y and Z positions of vectors
-		for (int32 TriIdx = 0; TriIdx < MeshData.TrianglesNum(); TriIdx++)
-		{
-			const FVector &Vertex0 = MeshData.VertexPositions[MeshData.Triangles[TriIdx].Vertex0];
-			const FVector &Vertex1 = MeshData.VertexPositions[MeshData.Triangles[TriIdx].Vertex1];
-			const FVector &Vertex2 = MeshData.VertexPositions[MeshData.Triangles[TriIdx].Vertex2];
-
-			vecMin.X = (vecMin.X > Vertex0.X) ? Vertex0.X : vecMin.X;
-			vecMin.X = (vecMin.X > Vertex1.X) ? Vertex1.X : vecMin.X;
-			vecMin.X = (vecMin.X > Vertex2.X) ? Vertex2.X : vecMin.X;
-
-			vecMin.Y = (vecMin.Y > Vertex0.Y) ? Vertex0.Y : vecMin.Y;
-			vecMin.Y = (vecMin.Y > Vertex1.Y) ? Vertex1.Y : vecMin.Y;
-			vecMin.Y = (vecMin.Y > Vertex2.Y) ? Vertex2.Y : vecMin.Y;
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_UpdateBounds);
 
-			vecMin.Z = (vecMin.Z > Vertex0.Z) ? Vertex0.Z : vecMin.Z;
-			vecMin.Z = (vecMin.Z > Vertex1.Z) ? Vertex1.Z : vecMin.Z;
-			vecMin.Z = (vecMin.Z > Vertex2.Z) ? Vertex2.Z : vecMin.Z;
-
-			vecMax.X = (vecMax.X < Vertex0.X) ? Vertex0.X : vecMax.X;
-			vecMax.X = (vecMax.X < Vertex1.X) ? Vertex1.X : vecMax.X;
-			vecMax.X = (vecMax.X < Vertex2.X) ? Vertex2.X : vecMax.X;
-
-			vecMax.Y = (vecMax.Y < Vertex0.Y) ? Vertex0.Y : vecMax.Y;
-			vecMax.Y = (vecMax.Y < Vertex1.Y) ? Vertex1.Y : vecMax.Y;
-			vecMax.Y = (vecMax.Y < Vertex2.Y) ? Vertex2.Y : vecMax.Y;
+	// Sections without triangles are invalid boxes and do not contribute
+	LocalBounds.Init();
+	for (const FProceduralMeshSection& Section : Sections)
+	{
+		LocalBounds += Section.LocalBox;
+	}
+}
 
-			vecMax.Z = (vecMax.Z < Vertex0.Z) ? Vertex0.Z : vecMax.Z;
-			vecMax.Z = (vecMax.Z < Vertex1.Z) ? Vertex1.Z : vecMax.Z;
-			vecMax.Z = (vecMax.Z < Vertex2.Z) ? Vertex2.Z : vecMax.Z;
-		}
+FBoxSphereBounds UProceduralMeshComponent::CalcBounds(const FTransform & LocalToWorld) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_CalcBounds);
 
-		FVector vecOrigin = ((vecMax - vecMin) / 2) + vecMin;	/* Origin = ((Max Vertex's Vector - Min Vertex's Vector) / 2 ) + Min Vertex's Vector */
-		FVector BoxPoint = vecMax - vecMin;			/* The difference between the "Maximum Vertex" and the "Minimum Vertex" is our actual Bounds Box */
-		return FBoxSphereBounds(vecOrigin, BoxPoint, BoxPoint.Size()).TransformBy(LocalToWorld);
+	if (LocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld);
 	}
 	else
 	{
@@ -438,30 +2464,68 @@ FBoxSphereBounds UProceduralMeshComponent::CalcBounds(const FTransform & LocalTo
 }
 
 
-bool UProceduralMeshComponent::GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+void UProceduralMeshComponent::BuildCollisionData(FTriMeshCollisionData& CollisionData) const
 {
-	FTriIndices Triangle;
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_BuildCollisionData);
+
+	int32 NumVertices = 0;
+	int32 NumTriangles = 0;
+	for (const FProceduralMeshSection& Section : Sections)
+	{
+		NumVertices += Section.MeshData.VerteciesNum();
+		NumTriangles += Section.MeshData.TrianglesNum();
+	}
 
-	for (int32 i = 0; i<MeshData.TrianglesNum(); i++)
+	CollisionData.Vertices.Reserve(CollisionData.Vertices.Num() + NumVertices);
+	CollisionData.Indices.Reserve(CollisionData.Indices.Num() + NumTriangles);
+	CollisionData.MaterialIndices.Reserve(CollisionData.MaterialIndices.Num() + NumTriangles);
+
+	// Shared vertices go in as they are, triangles only get offset by the section's first vertex
+	FTriIndices Triangle;
+	for (int32 SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
 	{
-		const FProceduralMeshTriangle& tri = MeshData.Triangles[i];
+		const FProceduralMeshData& MeshData = Sections[SectionIdx].MeshData;
+		if (MeshData.TrianglesNum() == 0)
+		{
+			continue;
+		}
 
-		Triangle.v0 = CollisionData->Vertices.Add(MeshData.VertexPositions[tri.Vertex0]);
-		Triangle.v1 = CollisionData->Vertices.Add(MeshData.VertexPositions[tri.Vertex1]);
-		Triangle.v2 = CollisionData->Vertices.Add(MeshData.VertexPositions[tri.Vertex2]);
+		const int32 VertexBase = CollisionData.Vertices.Num();
+		CollisionData.Vertices.Append(MeshData.VertexPositions);
+
+		const TArray<uint32>& Indices = MeshData.Indices;
+		for (int32 Idx = 0; Idx + 2 < Indices.Num(); Idx += 3)
+		{
+			Triangle.v0 = VertexBase + Indices[Idx + 0];
+			Triangle.v1 = VertexBase + Indices[Idx + 1];
+			Triangle.v2 = VertexBase + Indices[Idx + 2];
 
-		CollisionData->Indices.Add(Triangle);
-		CollisionData->MaterialIndices.Add(i);
+			CollisionData.Indices.Add(Triangle);
+			// The section index, so each section can map to its own physical material
+			CollisionData.MaterialIndices.Add((uint16)SectionIdx);
+		}
 	}
 
-	CollisionData->bFlipNormals = true;
+	CollisionData.bFlipNormals = true;
+}
+
+bool UProceduralMeshComponent::GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	BuildCollisionData(*CollisionData);
 
 	return true;
 }
 
 bool UProceduralMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
 {
-	return (MeshData.TrianglesNum() > 0);
+	for (const FProceduralMeshSection& Section : Sections)
+	{
+		if (Section.MeshData.TrianglesNum() > 0)
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
 void UProceduralMeshComponent::UpdateBodySetup()
@@ -476,20 +2540,57 @@ void UProceduralMeshComponent::UpdateBodySetup()
 
 void UProceduralMeshComponent::UpdateCollision()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_UpdateCollision);
+#if STATS
+	FScopeCycleCounterUObject ComponentScope(this);
+#endif
+
+	bCollisionDirty = false;
+
 	if(bPhysicsStateCreated)
 	{
-		DestroyPhysicsState();
-		UpdateBodySetup();
-		CreatePhysicsState();
+		if (bDeferCollisionCook && GetWorld() != NULL)
+		{
+			// Later updates before the next tick are folded into this cook
+			bCookQueued = true;
+			SetComponentTickEnabled(true);
+			return;
+		}
 
-		// Works in Packaged build only since UE4.5:
-		ModelBodySetup->InvalidatePhysicsData();
-		ModelBodySetup->CreatePhysicsMeshes();
+		CookCollision();
 	}
 }
 
+void UProceduralMeshComponent::CookCollision()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_Cook);
+	INC_DWORD_STAT(STAT_ProceduralMesh_CollisionCooks);
+
+	DestroyPhysicsState();
+	UpdateBodySetup();
+	CreatePhysicsState();
+
+	// Works in Packaged build only since UE4.5:
+	ModelBodySetup->InvalidatePhysicsData();
+	ModelBodySetup->CreatePhysicsMeshes();
+}
+
 UBodySetup* UProceduralMeshComponent::GetBodySetup()
 {
 	UpdateBodySetup();
 	return ModelBodySetup;
 }
+
+void UProceduralMeshComponent::PollQueuedCook()
+{
+	if (!bCookQueued)
+	{
+		return;
+	}
+
+	bCookQueued = false;
+	if (bPhysicsStateCreated)
+	{
+		CookCollision();
+	}
+}
@@ -6,8 +6,6 @@
 
 #include "ProceduralMeshComponent.generated.h"
 
-//Positions and colors should be seperate
-//UV's should be per face not per vertex?
 USTRUCT(BlueprintType)
 struct FProceduralMeshVertexUV
 {
@@ -28,8 +26,7 @@ struct FProceduralMeshVertexUV
 	float V;
 };
 
-//This replicates a lot of data, also makes it hard to look things up
-//should use int
+/** Triangle with per corner UVs, kept as an input for triangle based generators and converted by FProceduralMeshData::ConvertTriangles */
 USTRUCT(BlueprintType)
 struct FProceduralMeshTriangle
 {
@@ -64,27 +61,161 @@ struct FProceduralMeshTriangle
 	FProceduralMeshVertexUV UV2;
 };
 
+/** One UV per vertex */
+USTRUCT(BlueprintType)
+struct FProceduralMeshUVChannel
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	TArray<FVector2D> UVs;
+};
+
+/** Mesh data as contiguous per vertex streams, indexed by one flat triangle list */
 USTRUCT(BlueprintType)
 struct FProceduralMeshData
 {
 	GENERATED_USTRUCT_BODY()
 
+	FProceduralMeshData()
+		: Bounds(0){}
+
 	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
 	TArray<FVector> VertexPositions;
 
+	/** Optional, computed from the faces when empty */
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	TArray<FVector> VertexNormals;
+
+	/** Optional, computed from the faces when empty */
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	TArray<FVector> VertexTangents;
+
 	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
 	TArray<FColor> VertexColors;
 
+	/** Each channel is either empty or has one UV per vertex */
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	TArray<FProceduralMeshUVChannel> UVChannels;
+
+	/** Three vertex indices per triangle */
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	TArray<uint32> Indices;
+
+	/** Triangles with per corner UVs, moved into Indices and the first UV channel by ConvertTriangles */
 	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
 	TArray<FProceduralMeshTriangle> Triangles;
 
+	/** Optional local bounds set by generators that know their extents, computed from VertexPositions when invalid */
+	UPROPERTY(EditAnywhere, Category = "Procedual Mesh Data")
+	FBox Bounds;
+
 	int32 TrianglesNum() const;
 	int32 VerteciesNum() const;
 
+	/** Bytes allocated by all the arrays */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Box around VertexPositions, ignores Bounds */
+	FBox ComputePositionBounds() const;
+
 	void ResetTriangles();
 	void ResetVertices();
+
+	/** Append one triangle to Indices */
+	FORCEINLINE void AddTriangle(uint32 V0, uint32 V1, uint32 V2)
+	{
+		Indices.Add(V0);
+		Indices.Add(V1);
+		Indices.Add(V2);
+	}
+
+	/** Move Triangles into Indices, vertices used with several different UVs are duplicated. False if a triangle has an invalid index */
+	bool ConvertTriangles();
+
+private:
+	/** Append a copy of every stream of a vertex, returns its index */
+	int32 DuplicateVertex(int32 VertIdx);
 };
 
+/** One automatically simplified level of detail */
+USTRUCT(BlueprintType)
+struct FProceduralMeshLODInfo
+{
+	GENERATED_USTRUCT_BODY()
+
+	FProceduralMeshLODInfo()
+		: PercentTriangles(0.5f)
+		, ScreenSize(0.3f){}
+
+	/** Fraction of the triangles of the full mesh kept, never more than the LOD before */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float PercentTriangles;
+
+	/** Drawn once the bounds cover less than this fraction of the screen, like static mesh LODs */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = LOD, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float ScreenSize;
+
+	bool operator==(const FProceduralMeshLODInfo& Other) const
+	{
+		return PercentTriangles == Other.PercentTriangles && ScreenSize == Other.ScreenSize;
+	}
+};
+
+/** One independently updatable part of a procedural mesh, drawn with the material slot of the same index */
+USTRUCT()
+struct FProceduralMeshSection
+{
+	GENERATED_USTRUCT_BODY()
+
+	FProceduralMeshSection()
+		: LocalBox(0)
+		, bVerticesRenumbered(false)
+		, bUniqueRenderData(false)
+		, RenderDataSize(0)
+		, bSharedRenderData(false){}
+
+	/** The mesh data of this section */
+	UPROPERTY()
+	FProceduralMeshData MeshData;
+
+	/** Local space bounds of the section, invalid when it has no triangles */
+	UPROPERTY()
+	FBox LocalBox;
+
+	/** Index lists of the LODs after the full mesh, over the vertices of MeshData. Rebuilt rather than saved */
+	TArray<TArray<uint32>> LODIndices;
+
+	/** MeshData was reordered by bOptimizeVertexCache, its vertex indices are not the ones of the data passed in */
+	UPROPERTY()
+	bool bVerticesRenumbered;
+
+	/** Render data of this section is never shared, set once its colors are updated in place */
+	bool bUniqueRenderData;
+
+	/** CPU and GPU bytes of the render data last built or found for this section, see UProceduralMeshComponent::GetResourceSize */
+	SIZE_T RenderDataSize;
+
+	/** That render data came from the shared geometry cache */
+	bool bSharedRenderData;
+
+	/** That render data, to tell whether another section actually got it from the cache */
+	TWeakPtr<class FProceduralMeshProxySection, ESPMode::ThreadSafe> RenderData;
+
+	void Reset();
+
+	/** Take the generator bounds if valid, otherwise reduce over the vertex positions */
+	void UpdateLocalBox();
+};
+
+/** Render data of a section, reference counted since identical sections of different components share it */
+typedef TSharedPtr<class FProceduralMeshProxySection, ESPMode::ThreadSafe> FProceduralMeshProxySectionPtr;
+
+/** Fills in mesh data for GenerateMeshSectionAsync, runs on a worker thread so it must not touch any UObject */
+typedef TFunction<void(FProceduralMeshData&)> FProceduralMeshGenerator;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnProceduralMeshGenerated, int32, SectionIndex);
+
 /** Component that allows you to specify custom triangle mesh geometry */
 UCLASS(editinlinenew, meta = (BlueprintSpawnableComponent), ClassGroup=Rendering)
 class UProceduralMeshComponent : public UMeshComponent, public IInterface_CollisionDataProvider
@@ -101,18 +232,75 @@ public:
 	//UFUNCTION(BlueprintCallable, Category="Components|ProceduralMesh")
 	//void AddProceduralMeshTriangles(const TArray<FProceduralMeshTriangle>& Triangles);
 
-	/**Set the mesh data*/
+	/**Set the mesh data of the first section*/
 	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
 		bool SetMeshData(const FProceduralMeshData& Data);
 
+	/**Set the mesh data of a section, adding it if needed. Replacing an existing section only re-uploads that section's buffers */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		bool CreateMeshSection(int32 SectionIndex, const FProceduralMeshData& Data);
+
+	/** Take ownership of the data of the first section without copying it, see CreateMeshSection */
+	bool SetMeshData(FProceduralMeshData&& Data, bool bTrusted = false);
+
+	/** Take ownership of the data of a section without copying it. With bTrusted the index validation is skipped, for generators that guarantee valid topology */
+	bool CreateMeshSection(int32 SectionIndex, FProceduralMeshData&& Data, bool bTrusted = false);
+
+	/**Re-upload a section after modifying its data through GetMeshSectionData, pass false for bPositionsChanged after render only edits (i.e. colors) to keep the cached bounds and collision */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		bool UpdateMeshSection(int32 SectionIndex, bool bPositionsChanged = true);
+
+	/**Upload the positions (and normals or tangents if given) of a section after moving its vertices through GetMeshSectionData, i.e. every frame of a deformation.
+	 * The triangles must not have changed. With bUseDynamicBuffers only the position and tangent stream is rewritten in place and collision is just marked dirty,
+	 * otherwise this is UpdateMeshSection. With bOptimizeVertexCache the section's vertices are renumbered, address them through GetMeshSectionData rather than by the indices they were generated with */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		bool UpdateMeshSectionVertices(int32 SectionIndex);
+
+	/**Remove all geometry from a section, the section and its material slot are kept */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		void ClearMeshSection(int32 SectionIndex);
+
+	/**Remove all sections */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		void ClearAllMeshSections();
+
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		int32 GetNumSections() const;
+
 	/** Removes all geometry from this triangle mesh including vercixes and colors.  Does not deallocate memory, allowing new geometry to reuse the existing allocation. */
 	UFUNCTION(BlueprintCallable, Category="Components|ProceduralMesh")
 	void ClearProceduralMeshTriangles();
 
-	/**Get a refference to the data, adding or removing from sub arrays could cause errors, only modify data */
+	/**Get a refference to the data of the first section, adding or removing from sub arrays could cause errors, only modify data */
 	UFUNCTION(BLueprintCallable, Category = "Components|ProceduralMesh")
 		FProceduralMeshData& GetMeshData();
 
+	/**Get a refference to the data of a section, adding it if needed, call UpdateMeshSection after modifying it */
+	UFUNCTION(BLueprintCallable, Category = "Components|ProceduralMesh")
+		FProceduralMeshData& GetMeshSectionData(int32 SectionIndex);
+
+	/**Switch between welded, smooth shaded render vertices and one vertex per triangle corner with face normals */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		void SetFlatShading(bool bNewFlatShading);
+
+	/**Upload the colors of vertices [Start, Start + Count) of a section after changing them through GetMeshData, does not rebuild the scene proxy or touch collision.
+	 * Ranges are in the numbering of the section, which bOptimizeVertexCache changes, so it is meant for sections built with it off */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		void UpdateVertexColors(int32 Start, int32 Count, int32 SectionIndex = 0);
+
+	/**Run Generator on a worker thread into a back buffer and swap it into the section once done, then fire OnMeshGenerated.
+	 * Requests made while the section is still generating are coalesced, only the latest one runs afterwards.
+	 * Generates synchronously when the component is not registered yet (i.e. from an actor constructor) */
+	void GenerateMeshSectionAsync(int32 SectionIndex, const FProceduralMeshGenerator& Generator);
+
+	/**True while a generation of the section is running or queued */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		bool IsGeneratingMeshSection(int32 SectionIndex) const;
+
+	/**Called on the game thread after an asynchronously generated section was swapped in */
+	UPROPERTY(BlueprintAssignable, Category = "Components|ProceduralMesh")
+		FOnProceduralMeshGenerated OnMeshGenerated;
+
 	//Want a way to ensure that vertex colors and vertices stay the same...
 	//While ensuring that colors (and vertices) can still be changed
 
@@ -122,10 +310,74 @@ public:
 	//UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
 	//	TArray<	 TransformVertices(int32 VertexStart)
 
+	/** If true every triangle corner gets its own vertex and the face normal, otherwise corners sharing a vertex and UV are welded and smooth shaded */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Components|ProceduralMesh")
+	uint32 bFlatShading:1;
+
+	/** Simplified versions of every section drawn at decreasing screen sizes, rebuilt whenever a section's positions change */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = LOD)
+	TArray<FProceduralMeshLODInfo> LODs;
+
+	/** Replace the LOD chain and rebuild it for every section */
+	UFUNCTION(BlueprintCallable, Category = "Components|ProceduralMesh")
+		void SetLODs(const TArray<FProceduralMeshLODInfo>& NewLODs);
+
+	/** Draw through the renderer's static draw lists instead of building mesh batches every frame, for meshes that rarely change.
+	 * The draw lists point at the section buffers, so changing a section recreates the proxy on the dynamic path, and again on the static one
+	 * once the mesh has been left alone for StaticDrawDelay seconds. Off by default, other meshes swap changed sections into their proxy */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bUseStaticDrawPath:1;
+
+	/** Sections identical to ones of other components (same data, LODs and shading) share their vertex and index buffers and vertex factory */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bShareGeometry:1;
+
+	/** Keep positions and tangents in a ring of dynamic buffers rewritten by UpdateMeshSectionVertices, for meshes deformed every frame. Always drawn through the dynamic path and never shared */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bUseDynamicBuffers:1;
+
+	/** Free the render thread's copies of the vertices and indices once they are uploaded, the component keeps its own mesh data.
+	 * Updating colors and dynamic vertices still works, but the render data cannot be re-uploaded by itself (i.e. after a feature level change) and needs the proxy recreated */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bReleaseRenderData:1;
+
+	/** Store UVs as half floats, 4 instead of 8 bytes per channel. Precise enough for texture coordinates within a few dozen repeats */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bHalfPrecisionUVs:1;
+
+	/** Store positions as 16 bit integers over the bounds of their section, 8 instead of 12 bytes. A section 100m across is stepped in 1.5mm.
+	 * Ignored for movable components and dynamic buffers. Experimental: only run against the null RHI so far, check positions and shading on the target RHIs before turning it on */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bQuantizePositions:1;
+
+	/** Reorder the triangles of new sections and their LODs for the post-transform vertex cache and overdraw, and renumber their vertices by first use.
+	 * Applied by CreateMeshSection, SetMeshData and asynchronous generation, so vertex indices are not the ones of the data passed in.
+	 * Keep it off for meshes whose vertices are later addressed by index (i.e. UpdateVertexColors ranges) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bOptimizeVertexCache:1;
+
+	/** Build the render data of asynchronously generated sections on their worker thread too, leaving only the upload to the game thread.
+	 * Wasted when the section turns out to share the render data of an identical one, or when the proxy has to be recreated for it (new sections, static proxies) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering)
+	uint32 bBuildRenderDataAsync:1;
+
+	/** Seconds without section changes before an edited mesh goes back to the static draw path */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Rendering, meta = (ClampMin = "0.0"))
+	float StaticDrawDelay;
+
 	/** Description of collision */
 	UPROPERTY(BlueprintReadOnly, Category="Collision")
 	class UBodySetup* ModelBodySetup;
 
+	/** Cook collision on the next tick rather than right away, so all the edits made in between (i.e. several sections generated at once) cost one cook.
+	 * The cook is still synchronous on the game thread: UBodySetup::CreatePhysicsMeshes goes through the DDC and back into this component, so it cannot run on a worker */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Collision")
+	uint32 bDeferCollisionCook:1;
+
+	/** Mesh edits only mark collision as dirty, it is rebuilt on the next call to UpdateCollision */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Collision")
+	uint32 bDeferCollisionUpdates:1;
+
 	// Begin Interface_CollisionDataProvider Interface
 	virtual bool GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
 	virtual bool ContainsPhysicsTriMeshData(bool InUseAllTriData) const override;
@@ -141,17 +393,95 @@ public:
 	virtual int32 GetNumMaterials() const override;
 	// End UMeshComponent interface.
 
+	// Begin UActorComponent interface.
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+	// End UActorComponent interface.
+
+	// Begin UObject interface.
+	virtual void BeginDestroy() override;
+	virtual void PostLoad() override;
+	virtual SIZE_T GetResourceSize(EResourceSizeMode::Type Mode) override;
+#ifdef WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	// End UObject interface.
+
 	void UpdateBodySetup();
+
+	/** Rebuild collision from the current mesh, synchronously on the game thread. Right away, or on the next tick if bDeferCollisionCook is set */
+	UFUNCTION(BlueprintCallable, Category="Collision")
 	void UpdateCollision();
 
+	/** True if collision is out of date because of deferred updates */
+	bool IsCollisionDirty() const { return bCollisionDirty; }
+
 private:
 	// Begin USceneComponent interface.
 	virtual FBoxSphereBounds CalcBounds(const FTransform & LocalToWorld) const override;
 	// Begin USceneComponent interface.
 
-	/** The mesh data */
+	/** Check that colors match positions and, unless bTrusted, that every triangle index is valid */
+	static bool IsValidMeshData(const FProceduralMeshData& Data, bool bTrusted = false);
+
+	/** Refresh bounds and collision of a section if its positions changed and send it to the render thread, PrebuiltSection is its render data if already built */
+	void SectionChanged(int32 SectionIndex, bool bNewSection, bool bPositionsChanged = true, const FProceduralMeshProxySectionPtr& PrebuiltSection = FProceduralMeshProxySectionPtr());
+
+	/** Simplify a section into its LOD index lists */
+	void BuildSectionLODs(int32 SectionIndex);
+
+	/** Simplify Data into one index list per LOD info, reordered for the vertex cache if bOptimize. Touches no UObject */
+	static void BuildLODIndices(const FProceduralMeshData& Data, const TArray<FProceduralMeshLODInfo>& LODInfos, bool bOptimize, TArray<TArray<uint32>>& OutLODIndices);
+
+	/** Union of the section bounds into LocalBounds */
+	void UpdateLocalBounds();
+
+	/** Build the render data of a section or find an identical shared one, NULL if it has no triangles.
+	 * PrebuiltSection is used instead of building it when it was built with the current settings and the current mesh data */
+	FProceduralMeshProxySectionPtr CreateProxySection(int32 SectionIndex, const FProceduralMeshProxySectionPtr& PrebuiltSection = FProceduralMeshProxySectionPtr());
+
+	/** Settings the render data of a section is built with, a section that does not exist yet gets the ones of a new section */
+	struct FProceduralMeshRenderSettings GetRenderSettings(int32 SectionIndex) const;
+
+	/** Swap finished generations into their sections and start the queued ones */
+	void PollAsyncGenerations();
+
+	/** Append all sections to the collision data, sharing vertices between triangles */
+	void BuildCollisionData(struct FTriMeshCollisionData& CollisionData) const;
+
+	/** Recreate the physics state with a freshly cooked body setup, on the game thread */
+	void CookCollision();
+
+	/** Run the cook queued by UpdateCollision, if any */
+	void PollQueuedCook();
+
+	/** The mesh sections */
 	UPROPERTY()
-	FProceduralMeshData MeshData;
+	TArray<FProceduralMeshSection> Sections;
+
+	/** Cached local bounds of all sections, only recomputed when positions change so CalcBounds is just a transform */
+	UPROPERTY()
+	FBox LocalBounds;
+
+	/** Running or queued asynchronous generations, at most one per section */
+	TArray<class FProceduralMeshAsyncGeneration*> AsyncGenerations;
+
+	uint32 bCollisionDirty:1;
+
+	/** UpdateCollision was called with bDeferCollisionCook, cooked on the next tick */
+	uint32 bCookQueued:1;
+
+	/** Sections changed since StaticDrawDelay, the proxy uses the dynamic path so they can be swapped in without recreating it */
+	uint32 bMeshEditing:1;
+
+	/** The current proxy draws through the static draw lists */
+	uint32 bStaticProxy:1;
+
+	/** The current proxy was created with bUseDynamicBuffers */
+	uint32 bDynamicProxy:1;
+
+	/** FPlatformTime::Seconds() of the last section change */
+	double LastMeshEditTime;
 
 	friend class FProceduralMeshSceneProxy;
+	friend class FProceduralMeshGenerateTask;
 };
@@ -0,0 +1,300 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#include "ProceduralMesh.h"
+#include "ProceduralMeshOptimizer.h"
+
+DECLARE_CYCLE_STAT(TEXT("Optimize Triangle Order"), STAT_ProceduralMesh_OptimizeTriangles, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Optimize Vertex Fetch"), STAT_ProceduralMesh_OptimizeVertices, STATGROUP_ProceduralMesh);
+
+DEFINE_LOG_CATEGORY_STATIC(LogProceduralMeshOptimizer, Log, All);
+
+void FProceduralMeshOptimizer::Optimize(FProceduralMeshData& Data, FProceduralMeshVertexCacheStats* OutBefore, FProceduralMeshVertexCacheStats* OutAfter, int32 CacheSize)
+{
+	const FProceduralMeshVertexCacheStats Before = MeasureVertexCache(Data.Indices, Data.VerteciesNum(), CacheSize);
+
+	OptimizeTriangleOrder(Data.VertexPositions, Data.Indices, CacheSize);
+	OptimizeVertexFetch(Data);
+
+	const FProceduralMeshVertexCacheStats After = MeasureVertexCache(Data.Indices, Data.VerteciesNum(), CacheSize);
+
+	UE_LOG(LogProceduralMeshOptimizer, Verbose, TEXT("%d triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (cache of %d)"),
+		Data.Indices.Num() / 3, Before.ACMR, After.ACMR, Before.ATVR, After.ATVR, CacheSize);
+
+	if (OutBefore != NULL)
+	{
+		*OutBefore = Before;
+	}
+	if (OutAfter != NULL)
+	{
+		*OutAfter = After;
+	}
+}
+
+void FProceduralMeshOptimizer::OptimizeTriangleOrder(const TArray<FVector>& Positions, TArray<uint32>& Indices, int32 CacheSize)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_OptimizeTriangles);
+
+	const int32 NumVertices = Positions.Num();
+	const int32 NumTriangles = Indices.Num() / 3;
+	if (NumTriangles < 2)
+	{
+		return;
+	}
+
+	// Triangles of each vertex as one flat array, Live counts the ones not emitted yet
+	TArray<int32> Live;
+	Live.Init(0, NumVertices);
+	for (uint32 VertIdx : Indices)
+	{
+		Live[VertIdx]++;
+	}
+	TArray<int32> FirstAdjacent;
+	FirstAdjacent.SetNumUninitialized(NumVertices + 1);
+	FirstAdjacent[0] = 0;
+	for (int32 VertIdx = 0; VertIdx < NumVertices; VertIdx++)
+	{
+		FirstAdjacent[VertIdx + 1] = FirstAdjacent[VertIdx] + Live[VertIdx];
+	}
+	TArray<int32> Adjacent;
+	Adjacent.SetNumUninitialized(Indices.Num());
+	{
+		TArray<int32> NextAdjacent(FirstAdjacent);
+		for (int32 CornerIdx = 0; CornerIdx < Indices.Num(); CornerIdx++)
+		{
+			Adjacent[NextAdjacent[Indices[CornerIdx]]++] = CornerIdx / 3;
+		}
+	}
+
+	// Tipsify: fan around a vertex, emitting all of its remaining triangles, then move on to the vertex of the fan that will still be
+	// in the cache after its own triangles went through, or the most recently used one with triangles left when there is none (a dead end)
+	TArray<int32> CacheTime;
+	CacheTime.Init(0, NumVertices);
+	TArray<bool> bEmitted;
+	bEmitted.Init(false, NumTriangles);
+	TArray<int32> DeadEnds;
+	DeadEnds.Reserve(Indices.Num());
+	TArray<int32, TInlineAllocator<64>> Candidates;
+
+	TArray<int32> TriangleOrder;
+	TriangleOrder.Reserve(NumTriangles);
+	// Each dead end breaks the cache locality, what lies between two of them is a cluster that can be moved as a whole
+	TArray<int32> ClusterStart;
+	ClusterStart.Add(0);
+
+	int32 Time = CacheSize + 1;
+	int32 Cursor = 0;
+	int32 Fan = 0;
+	while (Fan >= 0)
+	{
+		Candidates.Reset();
+		for (int32 AdjIdx = FirstAdjacent[Fan]; AdjIdx < FirstAdjacent[Fan + 1]; AdjIdx++)
+		{
+			const int32 TriIdx = Adjacent[AdjIdx];
+			if (bEmitted[TriIdx])
+			{
+				continue;
+			}
+			bEmitted[TriIdx] = true;
+			TriangleOrder.Add(TriIdx);
+
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 VertIdx = Indices[TriIdx * 3 + Corner];
+				DeadEnds.Add(VertIdx);
+				Candidates.Add(VertIdx);
+				Live[VertIdx]--;
+				if (Time - CacheTime[VertIdx] > CacheSize)
+				{
+					CacheTime[VertIdx] = Time++;
+				}
+			}
+		}
+
+		// The candidate staying in the cache the longest, if fanning it fits
+		int32 Next = INDEX_NONE;
+		int32 BestPriority = -1;
+		for (int32 VertIdx : Candidates)
+		{
+			if (Live[VertIdx] > 0)
+			{
+				const int32 Age = Time - CacheTime[VertIdx];
+				const int32 Priority = Age + 2 * Live[VertIdx] <= CacheSize ? Age : 0;
+				if (Priority > BestPriority)
+				{
+					BestPriority = Priority;
+					Next = VertIdx;
+				}
+			}
+		}
+
+		if (Next == INDEX_NONE)
+		{
+			while (DeadEnds.Num() > 0 && Next == INDEX_NONE)
+			{
+				const int32 VertIdx = DeadEnds.Pop(false);
+				Next = Live[VertIdx] > 0 ? VertIdx : INDEX_NONE;
+			}
+			while (Next == INDEX_NONE && Cursor < NumVertices)
+			{
+				Next = Live[Cursor] > 0 ? Cursor : INDEX_NONE;
+				Cursor++;
+			}
+
+			if (Next != INDEX_NONE && TriangleOrder.Num() > ClusterStart.Last())
+			{
+				ClusterStart.Add(TriangleOrder.Num());
+			}
+		}
+
+		Fan = Next;
+	}
+	ClusterStart.Add(TriangleOrder.Num());
+	check(TriangleOrder.Num() == NumTriangles);
+
+	// Clusters facing away from the middle of the mesh tend to be in front of the others from wherever they are visible,
+	// drawn first they let early Z reject more of the rest
+	const int32 NumClusters = ClusterStart.Num() - 1;
+	TArray<FVector> ClusterCentroid;
+	TArray<FVector> ClusterNormal;
+	ClusterCentroid.AddZeroed(NumClusters);
+	ClusterNormal.AddZeroed(NumClusters);
+	FVector MeshCentroid = FVector::ZeroVector;
+	for (int32 Cluster = 0; Cluster < NumClusters; Cluster++)
+	{
+		for (int32 OrderIdx = ClusterStart[Cluster]; OrderIdx < ClusterStart[Cluster + 1]; OrderIdx++)
+		{
+			const uint32* Corners = &Indices[TriangleOrder[OrderIdx] * 3];
+			const FVector& P0 = Positions[Corners[0]];
+			const FVector& P1 = Positions[Corners[1]];
+			const FVector& P2 = Positions[Corners[2]];
+			// Same winding as the face normals of the render vertices, the length weighs it by area
+			ClusterNormal[Cluster] += (P2 - P0) ^ (P1 - P0);
+			ClusterCentroid[Cluster] += (P0 + P1 + P2) / 3.f;
+		}
+		MeshCentroid += ClusterCentroid[Cluster];
+		ClusterCentroid[Cluster] /= ClusterStart[Cluster + 1] - ClusterStart[Cluster];
+	}
+	MeshCentroid /= NumTriangles;
+
+	TArray<int32> ClusterOrder;
+	TArray<float> ClusterKey;
+	ClusterOrder.SetNumUninitialized(NumClusters);
+	ClusterKey.SetNumUninitialized(NumClusters);
+	for (int32 Cluster = 0; Cluster < NumClusters; Cluster++)
+	{
+		ClusterOrder[Cluster] = Cluster;
+		ClusterKey[Cluster] = (ClusterCentroid[Cluster] - MeshCentroid) | ClusterNormal[Cluster].GetSafeNormal();
+	}
+	// Ties keep the Tipsify order, so the result does not depend on the sort
+	ClusterOrder.Sort([&ClusterKey](int32 A, int32 B)
+	{
+		return ClusterKey[A] > ClusterKey[B] || (ClusterKey[A] == ClusterKey[B] && A < B);
+	});
+
+	TArray<uint32> NewIndices;
+	NewIndices.SetNumUninitialized(NumTriangles * 3);
+	uint32* Dest = NewIndices.GetData();
+	for (int32 Cluster : ClusterOrder)
+	{
+		for (int32 OrderIdx = ClusterStart[Cluster]; OrderIdx < ClusterStart[Cluster + 1]; OrderIdx++)
+		{
+			const uint32* Corners = &Indices[TriangleOrder[OrderIdx] * 3];
+			*Dest++ = Corners[0];
+			*Dest++ = Corners[1];
+			*Dest++ = Corners[2];
+		}
+	}
+
+	Indices = MoveTemp(NewIndices);
+}
+
+/** Move element i of Stream to NewIndex[i], streams not matching the vertex count are optional ones left empty */
+template<typename T>
+static void RemapStream(TArray<T>& Stream, const TArray<int32>& NewIndex)
+{
+	if (Stream.Num() != NewIndex.Num())
+	{
+		return;
+	}
+
+	TArray<T> Remapped;
+	Remapped.SetNumUninitialized(Stream.Num());
+	for (int32 VertIdx = 0; VertIdx < Stream.Num(); VertIdx++)
+	{
+		Remapped[NewIndex[VertIdx]] = Stream[VertIdx];
+	}
+	Stream = MoveTemp(Remapped);
+}
+
+void FProceduralMeshOptimizer::OptimizeVertexFetch(FProceduralMeshData& Data)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_OptimizeVertices);
+
+	const int32 NumVertices = Data.VerteciesNum();
+	if (NumVertices == 0 || Data.Triangles.Num() != 0)
+	{
+		return;
+	}
+
+	TArray<int32> NewIndex;
+	NewIndex.Init(INDEX_NONE, NumVertices);
+	int32 NumUsed = 0;
+	for (uint32& VertIdx : Data.Indices)
+	{
+		if (NewIndex[VertIdx] == INDEX_NONE)
+		{
+			NewIndex[VertIdx] = NumUsed++;
+		}
+		VertIdx = NewIndex[VertIdx];
+	}
+	for (int32 VertIdx = 0; VertIdx < NumVertices; VertIdx++)
+	{
+		if (NewIndex[VertIdx] == INDEX_NONE)
+		{
+			NewIndex[VertIdx] = NumUsed++;
+		}
+	}
+
+	RemapStream(Data.VertexPositions, NewIndex);
+	RemapStream(Data.VertexNormals, NewIndex);
+	RemapStream(Data.VertexTangents, NewIndex);
+	RemapStream(Data.VertexColors, NewIndex);
+	for (FProceduralMeshUVChannel& Channel : Data.UVChannels)
+	{
+		RemapStream(Channel.UVs, NewIndex);
+	}
+}
+
+FProceduralMeshVertexCacheStats FProceduralMeshOptimizer::MeasureVertexCache(const TArray<uint32>& Indices, int32 NumVertices, int32 CacheSize)
+{
+	FProceduralMeshVertexCacheStats Stats;
+	const int32 NumTriangles = Indices.Num() / 3;
+	if (NumTriangles == 0)
+	{
+		return Stats;
+	}
+
+	// A vertex is still cached if fewer than CacheSize misses happened since it was loaded, which is exactly a FIFO
+	TArray<int32> LoadedAt;
+	LoadedAt.Init(-CacheSize - 1, NumVertices);
+	TArray<bool> bReferenced;
+	bReferenced.Init(false, NumVertices);
+	int32 NumMisses = 0;
+	int32 NumReferenced = 0;
+	for (uint32 VertIdx : Indices)
+	{
+		if (NumMisses - LoadedAt[VertIdx] > CacheSize)
+		{
+			LoadedAt[VertIdx] = NumMisses++;
+		}
+		if (!bReferenced[VertIdx])
+		{
+			bReferenced[VertIdx] = true;
+			NumReferenced++;
+		}
+	}
+
+	Stats.ACMR = (float)NumMisses / NumTriangles;
+	Stats.ATVR = (float)NumMisses / NumReferenced;
+	return Stats;
+}
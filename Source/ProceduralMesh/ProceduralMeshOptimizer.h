@@ -0,0 +1,43 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "ProceduralMeshComponent.h"
+
+/** How well an index list uses a FIFO post-transform vertex cache */
+struct FProceduralMeshVertexCacheStats
+{
+	/** Average cache miss ratio, vertices transformed per triangle. 0.5 is the best a large regular grid can do, 3 is no reuse at all */
+	float ACMR;
+
+	/** Average transform to vertex ratio, vertices transformed per vertex referenced. 1 is optimal */
+	float ATVR;
+
+	FProceduralMeshVertexCacheStats()
+		: ACMR(0.f)
+		, ATVR(0.f){}
+};
+
+/**
+ * Reorders mesh data for the GPU: triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007), the clusters it produces
+ * for less overdraw (outward facing first), and vertices by first use so vertex fetch walks memory forward.
+ * The triangles themselves and their winding are unchanged. Touches no UObject, so it can run on a worker thread
+ */
+class PROCEDURALMESH_API FProceduralMeshOptimizer
+{
+public:
+	/** Cache size assumed by default, small enough to hold on every GPU the engine runs on */
+	static const int32 DefaultCacheSize = 16;
+
+	/** Reorder the triangles and then the vertices of Data, logs the cache stats before and after to LogProceduralMeshOptimizer (Verbose) */
+	static void Optimize(FProceduralMeshData& Data, FProceduralMeshVertexCacheStats* OutBefore = NULL, FProceduralMeshVertexCacheStats* OutAfter = NULL, int32 CacheSize = DefaultCacheSize);
+
+	/** Reorder the triangles of Indices over Positions for vertex cache reuse, then their clusters for overdraw */
+	static void OptimizeTriangleOrder(const TArray<FVector>& Positions, TArray<uint32>& Indices, int32 CacheSize = DefaultCacheSize);
+
+	/** Renumber the vertices of Data in the order Indices first uses them, every stream follows. Unused vertices go last */
+	static void OptimizeVertexFetch(FProceduralMeshData& Data);
+
+	/** Simulate a FIFO cache of CacheSize vertices over Indices */
+	static FProceduralMeshVertexCacheStats MeasureVertexCache(const TArray<uint32>& Indices, int32 NumVertices, int32 CacheSize = DefaultCacheSize);
+};
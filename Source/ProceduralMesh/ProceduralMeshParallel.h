@@ -0,0 +1,28 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "ParallelFor.h"
+
+/** Below this many elements a chunk is not worth waking a worker for */
+static const int32 ProceduralMeshMinElementsPerChunk = 16 * 1024;
+
+/** Run Body(First, End) over [0, Num) split into one chunk per thread, ranges under two chunks of MinPerChunk run in one go on the calling thread.
+ * Every element must be written by its own chunk only, so the output arrays have to be sized before */
+template<typename BodyType>
+void ParallelForChunks(int32 Num, const BodyType& Body, int32 MinPerChunk = ProceduralMeshMinElementsPerChunk)
+{
+	const int32 NumChunks = FMath::Min(FMath::Max(Num / FMath::Max(MinPerChunk, 1), 1), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+	if (NumChunks == 1)
+	{
+		Body(0, Num);
+		return;
+	}
+
+	const int32 ChunkSize = (Num + NumChunks - 1) / NumChunks;
+	ParallelFor(NumChunks, [&](int32 Chunk)
+	{
+		const int32 First = Chunk * ChunkSize;
+		Body(First, FMath::Min(First + ChunkSize, Num));
+	});
+}
@@ -0,0 +1,120 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#include "ProceduralMesh.h"
+#include "ProceduralMeshProfile.h"
+
+UProceduralMeshProfile::UProceduralMeshProfile(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, bClosed(false)
+	, LoopU(1.f)
+	, bCapEnds(true)
+	, TextureLength(100.f)
+{
+}
+
+void UProceduralMeshProfile::MakeBox(float Width, float Height, TArray<FProceduralMeshProfilePoint>& OutPoints)
+{
+	const float Perimeter = FMath::Max(2.f * Height + Width, KINDA_SMALL_NUMBER);
+
+	OutPoints.Reset(4);
+	OutPoints.Add(FProceduralMeshProfilePoint(FVector2D(-Width / 2.f, 0.f), 0.f, true));
+	OutPoints.Add(FProceduralMeshProfilePoint(FVector2D(-Width / 2.f, Height), Height / Perimeter, true));
+	OutPoints.Add(FProceduralMeshProfilePoint(FVector2D(Width / 2.f, Height), (Height + Width) / Perimeter, true));
+	OutPoints.Add(FProceduralMeshProfilePoint(FVector2D(Width / 2.f, 0.f), 1.f, true));
+}
+
+/** Outward normal of the edge from A to B, faces point to the left of it */
+static FVector2D EdgeNormal(const FVector2D& A, const FVector2D& B)
+{
+	const FVector2D Direction = B - A;
+	return FVector2D(-Direction.Y, Direction.X).GetSafeNormal();
+}
+
+void FProceduralMeshExtrusionTemplate::Build(const TArray<FProceduralMeshProfilePoint>& Points, bool bClosed, float LoopU, bool bCapEnds, float InTextureLength)
+{
+	RingPositions.Reset();
+	RingNormals.Reset();
+	RingU.Reset();
+	SegmentIndices.Reset();
+	CapPositions.Reset();
+	CapIndices.Reset();
+	TextureLength = FMath::Max(InTextureLength, 1.f);
+
+	const int32 NumPoints = Points.Num();
+	if (NumPoints < 2)
+	{
+		return;
+	}
+
+	const int32 NumEdges = bClosed ? NumPoints : NumPoints - 1;
+
+	// Ring vertex ending the edge into each point and starting the edge out of it, the same one unless the point is split
+	TArray<int32> InVertex;
+	TArray<int32> OutVertex;
+	InVertex.Init(INDEX_NONE, NumPoints);
+	OutVertex.Init(INDEX_NONE, NumPoints);
+
+	for (int32 PointIdx = 0; PointIdx < NumPoints; PointIdx++)
+	{
+		const FProceduralMeshProfilePoint& Point = Points[PointIdx];
+		const bool bHasIn = bClosed || PointIdx > 0;
+		const bool bHasOut = bClosed || PointIdx < NumPoints - 1;
+		const FVector2D InNormal = bHasIn ? EdgeNormal(Points[(PointIdx + NumPoints - 1) % NumPoints].Position, Point.Position) : FVector2D::ZeroVector;
+		const FVector2D OutNormal = bHasOut ? EdgeNormal(Point.Position, Points[(PointIdx + 1) % NumPoints].Position) : FVector2D::ZeroVector;
+
+		// The first point of a closed profile is always split, the edge back into it needs LoopU
+		const bool bSeam = bClosed && PointIdx == 0;
+		if ((Point.bHardEdge && bHasIn && bHasOut) || bSeam)
+		{
+			InVertex[PointIdx] = RingPositions.Num();
+			RingPositions.Add(Point.Position);
+			RingNormals.Add(Point.bHardEdge ? InNormal : (InNormal + OutNormal).GetSafeNormal());
+			RingU.Add(bSeam ? LoopU : Point.U);
+
+			OutVertex[PointIdx] = RingPositions.Num();
+			RingPositions.Add(Point.Position);
+			RingNormals.Add(Point.bHardEdge ? OutNormal : (InNormal + OutNormal).GetSafeNormal());
+			RingU.Add(Point.U);
+		}
+		else
+		{
+			InVertex[PointIdx] = OutVertex[PointIdx] = RingPositions.Num();
+			RingPositions.Add(Point.Position);
+			RingNormals.Add((InNormal + OutNormal).GetSafeNormal());
+			RingU.Add(Point.U);
+		}
+	}
+
+	const uint32 NextRing = RingPositions.Num();
+	SegmentIndices.Reserve(NumEdges * 6);
+	for (int32 Edge = 0; Edge < NumEdges; Edge++)
+	{
+		const uint32 A = OutVertex[Edge];
+		const uint32 B = InVertex[(Edge + 1) % NumPoints];
+
+		SegmentIndices.Add(A);
+		SegmentIndices.Add(B);
+		SegmentIndices.Add(B + NextRing);
+
+		SegmentIndices.Add(A);
+		SegmentIndices.Add(B + NextRing);
+		SegmentIndices.Add(A + NextRing);
+	}
+
+	if (bCapEnds && NumPoints > 2)
+	{
+		CapPositions.Reserve(NumPoints);
+		for (const FProceduralMeshProfilePoint& Point : Points)
+		{
+			CapPositions.Add(Point.Position);
+		}
+
+		CapIndices.Reserve((NumPoints - 2) * 3);
+		for (int32 PointIdx = 1; PointIdx < NumPoints - 1; PointIdx++)
+		{
+			CapIndices.Add(0);
+			CapIndices.Add(PointIdx + 1);
+			CapIndices.Add(PointIdx);
+		}
+	}
+}
@@ -0,0 +1,108 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "ProceduralMeshProfile.generated.h"
+
+/** One point of a cross section */
+USTRUCT(BlueprintType)
+struct FProceduralMeshProfilePoint
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Position across the spline, X to the right and Y up */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	FVector2D Position;
+
+	/** Texture coordinate across the spline */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	float U;
+
+	/** The surface creases at this point instead of being smoothed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	bool bHardEdge;
+
+	FProceduralMeshProfilePoint()
+		: Position(0.f, 0.f)
+		, U(0.f)
+		, bHardEdge(false)
+	{
+	}
+
+	FProceduralMeshProfilePoint(const FVector2D& InPosition, float InU, bool bInHardEdge)
+		: Position(InPosition)
+		, U(InU)
+		, bHardEdge(bInHardEdge)
+	{
+	}
+};
+
+/** A 2D cross section (pipe, rail, curb...) to extrude along a spline */
+UCLASS(BlueprintType)
+class PROCEDURALMESH_API UProceduralMeshProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UProceduralMeshProfile(const FObjectInitializer& ObjectInitializer);
+
+	/** The polyline, faces point to the left of it when walking along it looking down the spline */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	TArray<FProceduralMeshProfilePoint> Points;
+
+	/** Join the last point back to the first one */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	bool bClosed;
+
+	/** U of the first point again where a closed profile joins back to it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	float LoopU;
+
+	/** Close both ends of the spline, fan triangulated so the profile has to be convex */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile")
+	bool bCapEnds;
+
+	/** Distance along the spline covered by one repeat of the texture */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Profile", meta = (ClampMin = "1.0"))
+	float TextureLength;
+
+	/** The open box used when no profile is set: left, top and right sides, U by perimeter */
+	static void MakeBox(float Width, float Height, TArray<FProceduralMeshProfilePoint>& OutPoints);
+};
+
+/** Ring layout and index pattern of one segment of a profile, built once and stamped out along the spline with an offset */
+struct PROCEDURALMESH_API FProceduralMeshExtrusionTemplate
+{
+	/** Ring vertices, hard points have one per side and so does the seam of a closed profile */
+	TArray<FVector2D> RingPositions;
+	TArray<FVector2D> RingNormals;
+	TArray<float> RingU;
+
+	/** Triangles between ring 0 and ring 1, ring N is offset by N * RingSize() */
+	TArray<uint32> SegmentIndices;
+
+	/** Profile points of the cap vertices and the cap triangles over them, wound for the front cap */
+	TArray<FVector2D> CapPositions;
+	TArray<uint32> CapIndices;
+
+	float TextureLength;
+
+	FProceduralMeshExtrusionTemplate()
+		: TextureLength(100.f)
+	{
+	}
+
+	void Build(const TArray<FProceduralMeshProfilePoint>& Points, bool bClosed, float LoopU, bool bCapEnds, float InTextureLength);
+
+	int32 RingSize() const
+	{
+		return RingPositions.Num();
+	}
+
+	bool operator==(const FProceduralMeshExtrusionTemplate& Other) const
+	{
+		return RingPositions == Other.RingPositions && RingNormals == Other.RingNormals && RingU == Other.RingU && SegmentIndices == Other.SegmentIndices &&
+			CapPositions == Other.CapPositions && CapIndices == Other.CapIndices && TextureLength == Other.TextureLength;
+	}
+};
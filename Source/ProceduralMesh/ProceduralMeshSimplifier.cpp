@@ -0,0 +1,498 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#include "ProceduralMesh.h"
+#include "ProceduralMeshSimplifier.h"
+
+DECLARE_CYCLE_STAT(TEXT("Build LODs"), STAT_ProceduralMesh_BuildLODs, STATGROUP_ProceduralMesh);
+
+DEFINE_LOG_CATEGORY_STATIC(LogProceduralMeshSimplifier, Log, All);
+
+/** Sum of the squared distances to a set of planes, as a symmetric 4x4 matrix */
+struct FProceduralMeshQuadric
+{
+	double XX, XY, XZ, XW, YY, YZ, YW, ZZ, ZW, WW;
+
+	FProceduralMeshQuadric()
+		: XX(0), XY(0), XZ(0), XW(0), YY(0), YZ(0), YW(0), ZZ(0), ZW(0), WW(0){}
+
+	/** The plane through Point with the unit Normal, scaled by Weight */
+	FProceduralMeshQuadric(const FVector& Normal, const FVector& Point, double Weight)
+	{
+		const double A = Normal.X;
+		const double B = Normal.Y;
+		const double C = Normal.Z;
+		const double D = -(Normal | Point);
+
+		XX = Weight * A * A; XY = Weight * A * B; XZ = Weight * A * C; XW = Weight * A * D;
+		YY = Weight * B * B; YZ = Weight * B * C; YW = Weight * B * D;
+		ZZ = Weight * C * C; ZW = Weight * C * D;
+		WW = Weight * D * D;
+	}
+
+	FProceduralMeshQuadric& operator+=(const FProceduralMeshQuadric& Other)
+	{
+		XX += Other.XX; XY += Other.XY; XZ += Other.XZ; XW += Other.XW;
+		YY += Other.YY; YZ += Other.YZ; YW += Other.YW;
+		ZZ += Other.ZZ; ZW += Other.ZW;
+		WW += Other.WW;
+		return *this;
+	}
+
+	FProceduralMeshQuadric operator+(const FProceduralMeshQuadric& Other) const
+	{
+		FProceduralMeshQuadric Result(*this);
+		Result += Other;
+		return Result;
+	}
+
+	double Evaluate(const FVector& P) const
+	{
+		const double X = P.X;
+		const double Y = P.Y;
+		const double Z = P.Z;
+		return XX * X * X + 2.0 * XY * X * Y + 2.0 * XZ * X * Z + 2.0 * XW * X +
+			YY * Y * Y + 2.0 * YZ * Y * Z + 2.0 * YW * Y +
+			ZZ * Z * Z + 2.0 * ZW * Z +
+			WW;
+	}
+};
+
+/** Moving position From onto position To, entries whose positions changed since they were pushed are stale and skipped */
+struct FProceduralMeshCollapse
+{
+	float Cost;
+	int32 From;
+	int32 To;
+	uint32 FromStamp;
+	uint32 ToStamp;
+
+	/** A copy of From has no copy of To across an edge, so its triangles take the attributes of the other side of a seam */
+	bool bTearsSeam;
+
+	/** Collapses tearing a seam go after all the others */
+	bool operator<(const FProceduralMeshCollapse& Other) const
+	{
+		if (bTearsSeam != Other.bTearsSeam)
+		{
+			return !bTearsSeam;
+		}
+		return Cost < Other.Cost;
+	}
+};
+
+/** Open edges weigh this much more than faces, so the outline of the mesh goes last */
+static const double BoundaryWeight = 100.0;
+
+static uint64 EdgeKey(uint32 V0, uint32 V1)
+{
+	return V0 < V1 ? ((uint64)V0 << 32) | V1 : ((uint64)V1 << 32) | V0;
+}
+
+void FProceduralMeshSimplifier::BuildLODIndices(const FProceduralMeshData& Data, const TArray<FProceduralMeshLODInfo>& LODInfos, TArray<TArray<uint32>>& OutLODIndices)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_BuildLODs);
+
+	OutLODIndices.Reset();
+	OutLODIndices.SetNum(LODInfos.Num());
+
+	const TArray<FVector>& Positions = Data.VertexPositions;
+	const int32 NumVertices = Positions.Num();
+	const int32 NumTriangles = Data.Indices.Num() / 3;
+	if (LODInfos.Num() == 0 || NumTriangles == 0)
+	{
+		return;
+	}
+
+	// Vertices split for their attributes (hard edges, UV seams) have copies at the same position on the other side of the seam.
+	// The collapses run on positions and move all the copies of one at once, so both sides of a seam keep meeting
+	TArray<int32> VertexPosition;
+	TArray<int32> NextCopy;
+	TArray<int32> FirstCopy;
+	VertexPosition.SetNumUninitialized(NumVertices);
+	NextCopy.SetNumUninitialized(NumVertices);
+	{
+		TMap<FVector, int32> PositionIndices;
+		PositionIndices.Reserve(NumVertices);
+		for (int32 VertIdx = 0; VertIdx < NumVertices; VertIdx++)
+		{
+			const int32* Existing = PositionIndices.Find(Positions[VertIdx]);
+			const int32 PosIdx = Existing != NULL ? *Existing : FirstCopy.Add(INDEX_NONE);
+			if (Existing == NULL)
+			{
+				PositionIndices.Add(Positions[VertIdx], PosIdx);
+			}
+			VertexPosition[VertIdx] = PosIdx;
+			NextCopy[VertIdx] = FirstCopy[PosIdx];
+			FirstCopy[PosIdx] = VertIdx;
+		}
+	}
+	const int32 NumPositions = FirstCopy.Num();
+
+	auto PositionOf = [&](int32 PosIdx) -> const FVector&
+	{
+		return Positions[FirstCopy[PosIdx]];
+	};
+
+	// Corners are rewritten as positions collapse, removed triangles stay in place and are skipped
+	TArray<uint32> Corners(Data.Indices);
+	TArray<bool> bTriangleRemoved;
+	bTriangleRemoved.Init(false, NumTriangles);
+	int32 NumLiveTriangles = NumTriangles;
+
+	TArray<TArray<int32>> PositionTriangles;
+	PositionTriangles.SetNum(NumPositions);
+	for (int32 TriIdx = 0; TriIdx < NumTriangles; TriIdx++)
+	{
+		const int32 P0 = VertexPosition[Corners[TriIdx * 3 + 0]];
+		const int32 P1 = VertexPosition[Corners[TriIdx * 3 + 1]];
+		const int32 P2 = VertexPosition[Corners[TriIdx * 3 + 2]];
+		PositionTriangles[P0].Add(TriIdx);
+		if (P1 != P0)
+		{
+			PositionTriangles[P1].Add(TriIdx);
+		}
+		if (P2 != P0 && P2 != P1)
+		{
+			PositionTriangles[P2].Add(TriIdx);
+		}
+	}
+
+	// Every position starts with the planes of its faces, area weighted
+	TArray<FProceduralMeshQuadric> Quadrics;
+	Quadrics.AddZeroed(NumPositions);
+	TArray<FVector> FaceNormals;
+	FaceNormals.SetNumUninitialized(NumTriangles);
+	for (int32 TriIdx = 0; TriIdx < NumTriangles; TriIdx++)
+	{
+		const FVector& P0 = Positions[Corners[TriIdx * 3 + 0]];
+		const FVector Normal = (Positions[Corners[TriIdx * 3 + 2]] - P0) ^ (Positions[Corners[TriIdx * 3 + 1]] - P0);
+		const float DoubleArea = Normal.Size();
+		FaceNormals[TriIdx] = DoubleArea > SMALL_NUMBER ? Normal / DoubleArea : FVector::ZeroVector;
+		if (DoubleArea > SMALL_NUMBER)
+		{
+			const FProceduralMeshQuadric FaceQuadric(FaceNormals[TriIdx], P0, DoubleArea * 0.5);
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				Quadrics[VertexPosition[Corners[TriIdx * 3 + Corner]]] += FaceQuadric;
+			}
+		}
+	}
+
+	// Edges between positions, a seam is no edge of the surface
+	TMap<uint64, int32> EdgeUses;
+	EdgeUses.Reserve(NumTriangles * 3 / 2);
+	for (int32 TriIdx = 0; TriIdx < NumTriangles; TriIdx++)
+	{
+		for (int32 Corner = 0; Corner < 3; Corner++)
+		{
+			const int32 P0 = VertexPosition[Corners[TriIdx * 3 + Corner]];
+			const int32 P1 = VertexPosition[Corners[TriIdx * 3 + (Corner + 1) % 3]];
+			if (P0 != P1)
+			{
+				EdgeUses.FindOrAdd(EdgeKey(P0, P1))++;
+			}
+		}
+	}
+
+	// Open edges get a plane standing on them, so they only move along themselves
+	for (int32 TriIdx = 0; TriIdx < NumTriangles; TriIdx++)
+	{
+		for (int32 Corner = 0; Corner < 3; Corner++)
+		{
+			const int32 P0 = VertexPosition[Corners[TriIdx * 3 + Corner]];
+			const int32 P1 = VertexPosition[Corners[TriIdx * 3 + (Corner + 1) % 3]];
+			if (P0 == P1 || EdgeUses.FindRef(EdgeKey(P0, P1)) != 1)
+			{
+				continue;
+			}
+
+			const FVector Edge = PositionOf(P1) - PositionOf(P0);
+			const FVector PlaneNormal = (Edge ^ FaceNormals[TriIdx]).GetSafeNormal();
+			if (!PlaneNormal.IsZero())
+			{
+				const FProceduralMeshQuadric EdgeQuadric(PlaneNormal, PositionOf(P0), BoundaryWeight * Edge.SizeSquared());
+				Quadrics[P0] += EdgeQuadric;
+				Quadrics[P1] += EdgeQuadric;
+			}
+		}
+	}
+
+	// Copy of To that each copy of From becomes, INDEX_NONE outside of MapCopies
+	TArray<int32> CopyTarget;
+	CopyTarget.Init(INDEX_NONE, NumVertices);
+
+	// Every copy of From takes the copy of To it shares a triangle with, which is on its side of any seam. False if a copy in use has none
+	auto MapCopies = [&](int32 From, int32 To) -> bool
+	{
+		for (int32 TriIdx : PositionTriangles[From])
+		{
+			if (bTriangleRemoved[TriIdx])
+			{
+				continue;
+			}
+
+			const uint32* Tri = &Corners[TriIdx * 3];
+			int32 FromCorner = INDEX_NONE;
+			int32 ToCorner = INDEX_NONE;
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 PosIdx = VertexPosition[Tri[Corner]];
+				FromCorner = PosIdx == From ? Corner : FromCorner;
+				ToCorner = PosIdx == To ? Corner : ToCorner;
+			}
+			if (FromCorner != INDEX_NONE && ToCorner != INDEX_NONE && CopyTarget[Tri[FromCorner]] == INDEX_NONE)
+			{
+				CopyTarget[Tri[FromCorner]] = Tri[ToCorner];
+			}
+		}
+
+		for (int32 TriIdx : PositionTriangles[From])
+		{
+			if (bTriangleRemoved[TriIdx])
+			{
+				continue;
+			}
+
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const uint32 VertIdx = Corners[TriIdx * 3 + Corner];
+				if (VertexPosition[VertIdx] == From && CopyTarget[VertIdx] == INDEX_NONE)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	auto ClearCopies = [&](int32 From)
+	{
+		for (int32 VertIdx = FirstCopy[From]; VertIdx != INDEX_NONE; VertIdx = NextCopy[VertIdx])
+		{
+			CopyTarget[VertIdx] = INDEX_NONE;
+		}
+	};
+
+	// Copy of To for a copy of From that shares no triangle with one, the one facing the same way if there are normals
+	const bool bHasNormals = Data.VertexNormals.Num() == NumVertices;
+	auto ClosestCopy = [&](int32 VertIdx, int32 To) -> int32
+	{
+		int32 Best = FirstCopy[To];
+		float BestDot = -MAX_FLT;
+		for (int32 CopyIdx = FirstCopy[To]; bHasNormals && CopyIdx != INDEX_NONE; CopyIdx = NextCopy[CopyIdx])
+		{
+			const float Dot = Data.VertexNormals[VertIdx] | Data.VertexNormals[CopyIdx];
+			if (Dot > BestDot)
+			{
+				Best = CopyIdx;
+				BestDot = Dot;
+			}
+		}
+		return Best;
+	};
+
+	TArray<uint32> Stamps;
+	Stamps.Init(0, NumPositions);
+
+	TArray<FProceduralMeshCollapse> Heap;
+	Heap.Reserve(EdgeUses.Num() * 2);
+	bool bHeapBuilt = false;
+
+	auto PushCollapse = [&](int32 From, int32 To, const FProceduralMeshQuadric& Quadric)
+	{
+		FProceduralMeshCollapse Collapse;
+		Collapse.From = From;
+		Collapse.To = To;
+		Collapse.FromStamp = Stamps[From];
+		Collapse.ToStamp = Stamps[To];
+		Collapse.Cost = (float)Quadric.Evaluate(PositionOf(To));
+		Collapse.bTearsSeam = !MapCopies(From, To);
+		ClearCopies(From);
+
+		if (bHeapBuilt)
+		{
+			Heap.HeapPush(Collapse);
+		}
+		else
+		{
+			Heap.Add(Collapse);
+		}
+	};
+
+	auto AddCollapses = [&](int32 P0, int32 P1)
+	{
+		const FProceduralMeshQuadric Quadric = Quadrics[P0] + Quadrics[P1];
+		PushCollapse(P0, P1, Quadric);
+		PushCollapse(P1, P0, Quadric);
+	};
+
+	for (TMap<uint64, int32>::TConstIterator It(EdgeUses); It; ++It)
+	{
+		AddCollapses((int32)(It.Key() >> 32), (int32)(It.Key() & MAX_uint32));
+	}
+	EdgeUses.Empty();
+	Heap.Heapify();
+	bHeapBuilt = true;
+
+	// Targets only go down, so every LOD is a snapshot of the same run
+	TArray<int32> TargetTriangles;
+	TargetTriangles.SetNumUninitialized(LODInfos.Num());
+	int32 PreviousTarget = NumTriangles;
+	for (int32 LODIdx = 0; LODIdx < LODInfos.Num(); LODIdx++)
+	{
+		PreviousTarget = FMath::Min(PreviousTarget, FMath::RoundToInt(FMath::Clamp(LODInfos[LODIdx].PercentTriangles, 0.f, 1.f) * NumTriangles));
+		TargetTriangles[LODIdx] = PreviousTarget;
+	}
+
+	int32 NextLOD = 0;
+	int32 LastLODTriangles = NumTriangles;
+	auto EmitLOD = [&]()
+	{
+		TArray<uint32>& LODIndices = OutLODIndices[NextLOD++];
+		LODIndices.Reserve(NumLiveTriangles * 3);
+		for (int32 TriIdx = 0; TriIdx < NumTriangles; TriIdx++)
+		{
+			if (!bTriangleRemoved[TriIdx])
+			{
+				LODIndices.Append(&Corners[TriIdx * 3], 3);
+			}
+		}
+		LastLODTriangles = NumLiveTriangles;
+	};
+
+	while (NextLOD < LODInfos.Num() && NumLiveTriangles <= TargetTriangles[NextLOD])
+	{
+		EmitLOD();
+	}
+
+	TArray<int32, TInlineAllocator<16>> Neighbours;
+	while (NextLOD < LODInfos.Num() && Heap.Num() > 0)
+	{
+		FProceduralMeshCollapse Collapse;
+		Heap.HeapPop(Collapse, false);
+
+		const int32 From = Collapse.From;
+		const int32 To = Collapse.To;
+		if (Stamps[From] != Collapse.FromStamp || Stamps[To] != Collapse.ToStamp)
+		{
+			continue;
+		}
+
+		// Refuse collapses that would turn a remaining face over
+		bool bFlips = false;
+		for (int32 TriIdx : PositionTriangles[From])
+		{
+			if (bTriangleRemoved[TriIdx])
+			{
+				continue;
+			}
+
+			const uint32* Tri = &Corners[TriIdx * 3];
+			int32 TriPositions[3];
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				TriPositions[Corner] = VertexPosition[Tri[Corner]];
+			}
+			if (TriPositions[0] == To || TriPositions[1] == To || TriPositions[2] == To)
+			{
+				continue;
+			}
+
+			FVector Moved[3];
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				Moved[Corner] = PositionOf(TriPositions[Corner] == From ? To : TriPositions[Corner]);
+			}
+			const FVector OldNormal = (Positions[Tri[2]] - Positions[Tri[0]]) ^ (Positions[Tri[1]] - Positions[Tri[0]]);
+			const FVector NewNormal = (Moved[2] - Moved[0]) ^ (Moved[1] - Moved[0]);
+			if ((NewNormal | OldNormal) < 0.f)
+			{
+				bFlips = true;
+				break;
+			}
+		}
+		if (bFlips)
+		{
+			continue;
+		}
+
+		MapCopies(From, To);
+		for (int32 TriIdx : PositionTriangles[From])
+		{
+			if (bTriangleRemoved[TriIdx])
+			{
+				continue;
+			}
+
+			uint32* Tri = &Corners[TriIdx * 3];
+			if (VertexPosition[Tri[0]] == To || VertexPosition[Tri[1]] == To || VertexPosition[Tri[2]] == To)
+			{
+				bTriangleRemoved[TriIdx] = true;
+				NumLiveTriangles--;
+				continue;
+			}
+
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const uint32 VertIdx = Tri[Corner];
+				if (VertexPosition[VertIdx] == From)
+				{
+					Tri[Corner] = (uint32)(CopyTarget[VertIdx] != INDEX_NONE ? CopyTarget[VertIdx] : ClosestCopy(VertIdx, To));
+				}
+			}
+			PositionTriangles[To].Add(TriIdx);
+		}
+		ClearCopies(From);
+		PositionTriangles[From].Empty();
+
+		Quadrics[To] += Quadrics[From];
+		Stamps[From]++;
+		Stamps[To]++;
+
+		// Every edge left around To has a new cost
+		TArray<int32>& ToTriangles = PositionTriangles[To];
+		Neighbours.Reset();
+		for (int32 Idx = ToTriangles.Num() - 1; Idx >= 0; Idx--)
+		{
+			const int32 TriIdx = ToTriangles[Idx];
+			if (bTriangleRemoved[TriIdx])
+			{
+				ToTriangles.RemoveAtSwap(Idx);
+				continue;
+			}
+
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 PosIdx = VertexPosition[Corners[TriIdx * 3 + Corner]];
+				if (PosIdx != To)
+				{
+					Neighbours.AddUnique(PosIdx);
+				}
+			}
+		}
+
+		for (int32 Neighbour : Neighbours)
+		{
+			AddCollapses(To, Neighbour);
+		}
+
+		while (NextLOD < LODInfos.Num() && NumLiveTriangles <= TargetTriangles[NextLOD])
+		{
+			EmitLOD();
+		}
+	}
+
+	// Nothing left that can be collapsed: the first LOD short of its target gets the coarsest result, if it is any coarser than the LOD before.
+	// The LODs after it would only repeat it and are dropped, views past them draw the last one
+	if (NextLOD < LODInfos.Num())
+	{
+		UE_LOG(LogProceduralMeshSimplifier, Log, TEXT("LOD %d and after stop at %d of %d triangles, %d were asked for"),
+			NextLOD + 1, NumLiveTriangles, NumTriangles, TargetTriangles[NextLOD]);
+
+		if (NumLiveTriangles < LastLODTriangles)
+		{
+			EmitLOD();
+		}
+		OutLODIndices.SetNum(NextLOD);
+	}
+}
@@ -0,0 +1,23 @@
+// UE4 Procedural Mesh Generation from the Epic Wiki (https://wiki.unrealengine.com/Procedural_Mesh_Generation)
+
+#pragma once
+
+#include "ProceduralMeshComponent.h"
+
+/**
+ * Quadric error edge collapse simplification (Garland & Heckbert).
+ * Edges are collapsed onto one of their existing vertices, so every LOD is just another index list over the vertices of the full mesh.
+ * Collapses run on positions, the copies of a vertex split for its attributes (hard edges, UV seams) move together so both sides of a seam keep meeting.
+ * Collapses that would give triangles the attributes of the other side of a seam are only taken once no other is left.
+ */
+class PROCEDURALMESH_API FProceduralMeshSimplifier
+{
+public:
+	/**
+	 * One index list per LOD info keeping about PercentTriangles of the triangles of Data, built in a single run from the finest to the coarsest.
+	 * A LOD never has more triangles than the one before it. When a target cannot be reached, that LOD gets the coarsest result and the ones after it are dropped,
+	 * so OutLODIndices can end up with fewer entries than LODInfos.
+	 * Touches no UObject, so it can run on a worker thread
+	 */
+	static void BuildLODIndices(const FProceduralMeshData& Data, const TArray<FProceduralMeshLODInfo>& LODInfos, TArray<TArray<uint32>>& OutLODIndices);
+};
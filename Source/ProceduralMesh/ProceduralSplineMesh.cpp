@@ -5,13 +5,21 @@
 
 #include "Components/SplineComponent.h"
 #include "ProceduralMeshComponent.h"
+#include "ProceduralMeshProfile.h"
+#include "ProceduralMeshCache.h"
 
+DECLARE_CYCLE_STAT(TEXT("Sample Spline"), STAT_ProceduralMesh_SampleSpline, STATGROUP_ProceduralMesh);
+DECLARE_CYCLE_STAT(TEXT("Extrude Spline"), STAT_ProceduralMesh_ExtrudeSpline, STATGROUP_ProceduralMesh);
 
 // Sets default values
 AProceduralSplineMesh::AProceduralSplineMesh(const FObjectInitializer& ObjectInitializer)
-	: MeshHeight(50.f)
+	: Profile(NULL)
+	, MeshHeight(50.f)
 	, MeshWidth(10.f)
 	, SegmentLength(10.f)
+	, SegmentsPerSection(64)
+	, SampledSegmentLength(0.f)
+	, BuiltSegmentsPerSection(0)
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -20,14 +28,18 @@ AProceduralSplineMesh::AProceduralSplineMesh(const FObjectInitializer& ObjectIni
 	RootComponent = Spline;
 
 	Mesh = ObjectInitializer.CreateDefaultSubobject<UProceduralMeshComponent>(this, TEXT("Procedural Spline Mesh"));
+
+	// Hard edges are split in the profile, smooth along the spline
+	Mesh->bFlatShading = false;
+	// Edits regenerate sections in place, their render data can be built next to them on the worker
+	Mesh->bBuildRenderDataAsync = true;
+
+	bDeferringCollision = false;
+	bSavedDeferCollisionUpdates = false;
 	
-	FProceduralMeshData Data;
-	CreateMesh(Data);
-	Mesh->SetMeshData(Data);
+	UpdateMesh(false, true);
 
 	Mesh->AttachTo(Spline);
-
-	NumberOfSegments = FMath::FloorToInt(Spline->GetSplineLength() / SegmentLength);
 }
 
 // Called when the game starts or when spawned
@@ -47,177 +59,475 @@ void AProceduralSplineMesh::Tick( float DeltaTime )
 #ifdef WITH_EDITOR
 void AProceduralSplineMesh::PostEditChangeProperty(FPropertyChangedEvent & PropertyChangedEvent)
 {
-	//TODO expand this for more stuff, for now don't care
-	FProceduralMeshData Data;
-	CreateMesh(Data);
-	Mesh->SetMeshData(Data);
+	// Collision is cooked once the edit is done rather than on every step of a drag. The override lasts the whole drag,
+	// generations started by it finish later, and the mesh gets its own setting back with the final change
+	const bool bInteractive = PropertyChangedEvent.ChangeType == EPropertyChangeType::Interactive;
+	if (bInteractive && !bDeferringCollision)
+	{
+		bDeferringCollision = true;
+		bSavedDeferCollisionUpdates = Mesh->bDeferCollisionUpdates;
+		Mesh->bDeferCollisionUpdates = true;
+	}
+	else if (!bInteractive && bDeferringCollision)
+	{
+		bDeferringCollision = false;
+		Mesh->bDeferCollisionUpdates = bSavedDeferCollisionUpdates;
+	}
+
+	// Steps of a drag are seen once, caching them would only write entries nothing loads
+	UpdateMesh(true, !bInteractive);
+
+	if (!bInteractive && !Mesh->bDeferCollisionUpdates && Mesh->IsCollisionDirty())
+	{
+		Mesh->UpdateCollision();
+	}
 
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 }
 #endif
 
-bool AProceduralSplineMesh::CreateMesh(FProceduralMeshData& OutMesh)
+void AProceduralSplineMesh::UpdateMesh(bool bAsync, bool bUseCache)
 {
-	//want to generate all points in local space but spline will give us world so lets cache it for quicker math
-	FVector WorldLocaction = Spline->GetComponentLocation();
-
-	NumberOfSegments = FMath::FloorToInt(Spline->GetSplineLength() / SegmentLength);
-
-	//base vectors
-	FVector v0(0.f, -(MeshWidth / 2.f), MeshHeight);
-	FVector v1(0.f,   MeshWidth / 2.f,  MeshHeight);
-	FVector v2(0.f, -(MeshWidth / 2.f),        0.f);
-	FVector v3(0.f,   MeshWidth / 2.f,         0.f);
-
-	float PositionOnSpline = 0.f;
-
-	FProceduralMeshTriangle Tri;
-
-	for (int32 Segment = 0; Segment < NumberOfSegments; Segment++)
-	{
-		//Do front(?) face of box
-		if (Segment == 0)
-		{
-			Tri.Vertex0 = 0;
-			Tri.Vertex1 = 2;
-			Tri.Vertex2 = 1;
-			OutMesh.Triangles.Add(Tri);
-
-			Tri.Vertex0 = 1;
-			Tri.Vertex1 = 2;
-			Tri.Vertex2 = 3;
-			OutMesh.Triangles.Add(Tri);
-		}
-
-		//Add vertices
-		FVector SplineOffset = Spline->GetWorldLocationAtDistanceAlongSpline(PositionOnSpline);
-		SplineOffset -= WorldLocaction;
-
-		//also need to rotate by spline tangent
-		FVector SplineTangent = Spline->GetWorldTangentAtDistanceAlongSpline(PositionOnSpline);
-		
-
-		OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v0) + SplineOffset);
-		OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v1) + SplineOffset);
-		OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v2) + SplineOffset);
-		OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v3) + SplineOffset);
-
-		//add other faces
-		int Row = Segment * 4;
-		int NextRow = (Segment + 1) * 4;
-
-		//right
-		Tri.Vertex0 = Row + 1;
-		Tri.Vertex1 = Row + 3;
-		Tri.Vertex2 = NextRow + 3;
-		OutMesh.Triangles.Add(Tri);
-		Tri.Vertex0 = Row + 1;
-		Tri.Vertex1 = NextRow + 3;
-		Tri.Vertex2 = NextRow + 1;
-		OutMesh.Triangles.Add(Tri);
-
-		//Top
-		Tri.Vertex0 = Row + 0;
-		Tri.Vertex1 = NextRow + 1;
-		Tri.Vertex2 = NextRow + 0;
-		OutMesh.Triangles.Add(Tri);
-		Tri.Vertex1 = Row + 1;
-		Tri.Vertex0 = Row + 0;
-		Tri.Vertex2 = NextRow + 1;
-		OutMesh.Triangles.Add(Tri);
-
-		//left
-		Tri.Vertex0 = NextRow + 0;
-		Tri.Vertex1 = Row + 2;
-		Tri.Vertex2 = Row + 0;
-		OutMesh.Triangles.Add(Tri);
-		Tri.Vertex0 = NextRow + 0;
-		Tri.Vertex1 = NextRow + 2;
-		Tri.Vertex2 = Row + 2;
-		OutMesh.Triangles.Add(Tri);
-
-		PositionOnSpline += SegmentLength;
-
-		if (Segment == NumberOfSegments - 1)
-		{
-			//Add a final set of vertices
-			SplineOffset = Spline->GetWorldLocationAtDistanceAlongSpline(PositionOnSpline);
-			SplineOffset -= WorldLocaction;
-			FVector SplineTangent = Spline->GetWorldTangentAtDistanceAlongSpline(PositionOnSpline);
-
-			OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v0) + SplineOffset);
-			OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v1) + SplineOffset);
-			OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v2) + SplineOffset);
-			OutMesh.VertexPositions.Add(SplineTangent.Rotation().RotateVector(v3) + SplineOffset);
-		
-			//add the back face
-			Tri.Vertex0 = NextRow + 1;
-			Tri.Vertex1 = NextRow + 3;
-			Tri.Vertex2 = NextRow + 0;
-			OutMesh.Triangles.Add(Tri);
-			Tri.Vertex0 = NextRow + 0;
-			Tri.Vertex1 = NextRow + 3;
-			Tri.Vertex2 = NextRow + 2;
-			OutMesh.Triangles.Add(Tri);
-		}
-	}
-
-	//Add colors
-	int NumberOfVertices = OutMesh.VertexPositions.Num();
-
-	//TODO for testing only!
-	uint8 Red = 254;
-	uint8 Green = 1;
-	uint8 Alpha = 1;
-	int8 Delta = 4;
-	int8 DeltaAlpha = 1;
-	for (int32 c = 0; c < NumberOfVertices; c += 4)
-	{
-		uint16 Check = Green + Delta;
-		if (Check > 255)
-		{
-			Delta = -4;
+	//Sampling has to read the spline so it stays here, the extrusion can be done on a worker thread.
+	//The frames are only sampled again if the spline changed, the previous table stays alive in running generators
+	FProceduralSplineFramesPtr NewFrames = Frames;
+	if (!Frames.IsValid() || SegmentLength != SampledSegmentLength || !(Tessellation == SampledTessellation) || !IsSameCurve(Spline->SplineInfo, SampledSplineInfo))
+	{
+		TSharedPtr<TArray<FProceduralSplineFrame>, ESPMode::ThreadSafe> Sampled = MakeShareable(new TArray<FProceduralSplineFrame>());
+		SampleSpline(*Sampled);
+		NewFrames = Sampled;
+
+		SampledSplineInfo = Spline->SplineInfo;
+		SampledSegmentLength = SegmentLength;
+		SampledTessellation = Tessellation;
+	}
+
+	// The topology template is cheap to build, comparing it catches any change of the profile or of the box size
+	TSharedPtr<FProceduralMeshExtrusionTemplate, ESPMode::ThreadSafe> BuiltTemplate = MakeShareable(new FProceduralMeshExtrusionTemplate());
+	if (Profile != NULL)
+	{
+		BuiltTemplate->Build(Profile->Points, Profile->bClosed, Profile->LoopU, Profile->bCapEnds, Profile->TextureLength);
+	}
+	else
+	{
+		TArray<FProceduralMeshProfilePoint> BoxPoints;
+		UProceduralMeshProfile::MakeBox(MeshWidth, MeshHeight, BoxPoints);
+		BuiltTemplate->Build(BoxPoints, false, 1.f, true, 100.f);
+	}
+	const bool bTemplateChanged = !Template.IsValid() || !(*BuiltTemplate == *Template);
+	FProceduralMeshTemplatePtr NewTemplate = bTemplateChanged ? FProceduralMeshTemplatePtr(BuiltTemplate) : Template;
+
+	const TArray<FProceduralSplineFrame>& NewTable = *NewFrames;
+	const int32 NumSamples = NewTable.Num();
+	const int32 NumSegments = FMath::Max(NumSamples - 1, 0);
+	const int32 SectionSize = FMath::Max(SegmentsPerSection, 1);
+	const int32 NumSections = (NumSegments + SectionSize - 1) / SectionSize;
+	NumberOfSegments = NumSegments;
+
+	// A new profile or section size changes every section, anything else only the sections whose samples changed
+	const bool bRebuildAll = !Frames.IsValid() || bTemplateChanged || SectionSize != BuiltSegmentsPerSection;
+	const int32 NumOldSamples = Frames.IsValid() ? Frames->Num() : 0;
+	const int32 NumOldSections = (FMath::Max(NumOldSamples - 1, 0) + SectionSize - 1) / SectionSize;
+
+	// Sections past the end are emptied, through the generation queue when async so that one still running cannot fill them again
+	for (int32 Section = NumSections; Section < Mesh->GetNumSections(); Section++)
+	{
+		if (bAsync)
+		{
+			Mesh->GenerateMeshSectionAsync(Section, [](FProceduralMeshData& OutMesh){});
+		}
+		else
+		{
+			Mesh->ClearMeshSection(Section);
+		}
+	}
+
+	for (int32 Section = 0; Section < NumSections; Section++)
+	{
+		// A section is built from the samples at both ends of its segments, the boundary sample is shared with the next one
+		const int32 FirstSegment = Section * SectionSize;
+		const int32 SectionSegments = FMath::Min(SectionSize, NumSegments - FirstSegment);
+
+		// The last section is capped at the end of the spline, it is not the same mesh once another section is last.
+		// Samples past the end of the old table are changed ones
+		bool bChanged = bRebuildAll || Section >= Mesh->GetNumSections() ||
+			(NumSamples != NumOldSamples && (Section == NumSections - 1 || Section == NumOldSections - 1));
+		for (int32 Sample = FirstSegment; !bChanged && NewFrames != Frames && Sample <= FirstSegment + SectionSegments; Sample++)
+		{
+			bChanged = Sample >= NumOldSamples || !NewTable[Sample].Equals((*Frames)[Sample]);
+		}
+		if (!bChanged)
+		{
+			continue;
+		}
+
+		// Every section draws with the material of the first one
+		if (Section > 0 && Mesh->GetMaterial(Section) == NULL && Mesh->GetMaterial(0) != NULL)
+		{
+			Mesh->SetMaterial(Section, Mesh->GetMaterial(0));
+		}
+
+		if (bAsync)
+		{
+			Mesh->GenerateMeshSectionAsync(Section, [NewFrames, NewTemplate, FirstSegment, SectionSegments, bUseCache](FProceduralMeshData& OutMesh)
+			{
+				if (bUseCache)
+				{
+					ExtrudeMeshCached(*NewFrames, *NewTemplate, FirstSegment, SectionSegments, OutMesh);
+				}
+				else
+				{
+					ExtrudeMesh(*NewFrames, *NewTemplate, FirstSegment, SectionSegments, OutMesh);
+				}
+			});
 		}
 		else
 		{
-			Check = Red + Delta;
-			if (Check > 255)
+			FProceduralMeshData Data;
+			if (bUseCache)
+			{
+				ExtrudeMeshCached(NewTable, *NewTemplate, FirstSegment, SectionSegments, Data);
+			}
+			else
 			{
-				Delta = 4;
+				ExtrudeMesh(NewTable, *NewTemplate, FirstSegment, SectionSegments, Data);
 			}
+			Mesh->CreateMeshSection(Section, MoveTemp(Data), true);
 		}
+	}
+
+	Frames = NewFrames;
+	Template = NewTemplate;
+	BuiltSegmentsPerSection = SectionSize;
+}
+
+bool AProceduralSplineMesh::IsSameCurve(const FInterpCurveVector& A, const FInterpCurveVector& B)
+{
+	if (A.Points.Num() != B.Points.Num())
+	{
+		return false;
+	}
 
-		if (Alpha + DeltaAlpha > 25)
+	for (int32 PointIdx = 0; PointIdx < A.Points.Num(); PointIdx++)
+	{
+		const FInterpCurvePoint<FVector>& PointA = A.Points[PointIdx];
+		const FInterpCurvePoint<FVector>& PointB = B.Points[PointIdx];
+		if (PointA.InVal != PointB.InVal || PointA.OutVal != PointB.OutVal || PointA.ArriveTangent != PointB.ArriveTangent ||
+			PointA.LeaveTangent != PointB.LeaveTangent || PointA.InterpMode != PointB.InterpMode)
 		{
-			DeltaAlpha = -1;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/** Value and derivative of a curve between two of its points, the same way FInterpCurve::Eval does it */
+template<typename T>
+static T EvalCurveSegment(const FInterpCurvePoint<T>& Prev, const FInterpCurvePoint<T>& Next, float InVal, T& OutDerivative)
+{
+	const float Diff = Next.InVal - Prev.InVal;
+	if (Diff <= 0.f || Prev.InterpMode == CIM_Constant)
+	{
+		OutDerivative = T(0);
+		return Prev.OutVal;
+	}
+
+	const float Alpha = FMath::Clamp((InVal - Prev.InVal) / Diff, 0.f, 1.f);
+	if (Prev.InterpMode == CIM_Linear)
+	{
+		OutDerivative = (Next.OutVal - Prev.OutVal) / Diff;
+		return FMath::Lerp(Prev.OutVal, Next.OutVal, Alpha);
+	}
 
+	OutDerivative = FMath::CubicInterpDerivative(Prev.OutVal, Prev.LeaveTangent * Diff, Next.OutVal, Next.ArriveTangent * Diff, Alpha) / Diff;
+	return FMath::CubicInterp(Prev.OutVal, Prev.LeaveTangent * Diff, Next.OutVal, Next.ArriveTangent * Diff, Alpha);
+}
+
+/** Evaluates the spline by distance, walking the distance to key table and the curve from the previous position instead of searching them */
+struct FProceduralSplineSweep
+{
+	const FInterpCurveVector& Curve;
+	const FInterpCurveFloat& Reparam;
+	int32 ReparamIdx;
+	int32 CurveIdx;
+
+	FProceduralSplineSweep(const FInterpCurveVector& InCurve, const FInterpCurveFloat& InReparam)
+		: Curve(InCurve)
+		, Reparam(InReparam)
+		, ReparamIdx(0)
+		, CurveIdx(0)
+	{
+		check(Curve.Points.Num() > 1 && Reparam.Points.Num() > 1);
+	}
+
+	/** Position and unnormalized tangent, cheapest when called with close distances */
+	FProceduralSplineFrame Eval(float Distance)
+	{
+		WalkTo(Reparam.Points, ReparamIdx, Distance);
+		float KeyDerivative;
+		const float Key = EvalCurveSegment(Reparam.Points[ReparamIdx], Reparam.Points[ReparamIdx + 1], Distance, KeyDerivative);
+
+		WalkTo(Curve.Points, CurveIdx, Key);
+		FProceduralSplineFrame Frame;
+		Frame.Position = EvalCurveSegment(Curve.Points[CurveIdx], Curve.Points[CurveIdx + 1], Key, Frame.Tangent);
+		Frame.Distance = Distance;
+		return Frame;
+	}
+
+private:
+	template<typename T>
+	static void WalkTo(const TArray<FInterpCurvePoint<T>>& Points, int32& Idx, float InVal)
+	{
+		while (Idx > 0 && Points[Idx].InVal > InVal)
+		{
+			Idx--;
 		}
-		else
+		while (Idx + 2 < Points.Num() && Points[Idx + 1].InVal <= InVal)
 		{
-			int32 DeltaCheck = int32(Alpha) + int32(DeltaAlpha);
-			if (DeltaCheck < 1)
+			Idx++;
+		}
+	}
+};
+
+void AProceduralSplineMesh::SampleSpline(TArray<FProceduralSplineFrame>& OutFrames)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_SampleSpline);
+
+	OutFrames.Reset();
+
+	// The mesh is attached to the spline, so samples stay in spline space
+	const FInterpCurveVector& Curve = Spline->SplineInfo;
+	const FInterpCurveFloat& Reparam = Spline->SplineReparamTable;
+	if (Curve.Points.Num() < 2 || Reparam.Points.Num() < 2)
+	{
+		return;
+	}
+
+	const float SplineLength = Spline->GetSplineLength();
+	FProceduralSplineSweep Sweep(Curve, Reparam);
+
+	if (!Tessellation.bAdaptive)
+	{
+		const int32 NumSegments = FMath::FloorToInt(SplineLength / SegmentLength);
+
+		//one sample per segment start plus the end of the last one
+		const int32 NumberOfSamples = (NumSegments > 0) ? NumSegments + 1 : 0;
+		OutFrames.Reserve(NumberOfSamples);
+		for (int32 Sample = 0; Sample < NumberOfSamples; Sample++)
+		{
+			OutFrames.Add(Sweep.Eval(Sample * SegmentLength));
+		}
+	}
+	else if (SplineLength > 0.f)
+	{
+		// Take the longest step allowed, halving it until the middle of the segment is close enough to its chord and
+		// the tangent turns little enough along it
+		const float MinStep = FMath::Max(Tessellation.MinSegmentLength, 1.f);
+		const float MaxStep = FMath::Max(Tessellation.MaxSegmentLength, MinStep);
+		const float MinCosAngle = FMath::Cos(FMath::DegreesToRadians(Tessellation.MaxAngleError));
+
+		OutFrames.Add(Sweep.Eval(0.f));
+		float Distance = 0.f;
+		while (Distance < SplineLength)
+		{
+			const FProceduralSplineFrame Start = OutFrames.Last();
+			const FVector StartTangent = Start.Tangent.GetSafeNormal();
+
+			float Step = FMath::Min(MaxStep, SplineLength - Distance);
+			FProceduralSplineFrame End = Sweep.Eval(Distance + Step);
+			while (Step > MinStep)
 			{
-				DeltaAlpha = 1;
+				const FProceduralSplineFrame Middle = Sweep.Eval(Distance + Step * 0.5f);
+				const float ChordError = FMath::PointDistToSegment(Middle.Position, Start.Position, End.Position);
+				const float CosAngle = StartTangent | End.Tangent.GetSafeNormal();
+				if (ChordError <= Tessellation.MaxChordError && CosAngle >= MinCosAngle)
+				{
+					break;
+				}
+
+				Step = FMath::Max(Step * 0.5f, MinStep);
+				End = Sweep.Eval(Distance + Step);
 			}
+
+			// Never leave a sliver shorter than the minimum at the end of the spline
+			const float Remaining = SplineLength - (Distance + Step);
+			if (Remaining > 0.f && Remaining < MinStep)
+			{
+				Step += Remaining;
+				End = Sweep.Eval(SplineLength);
+			}
+
+			Distance += Step;
+			OutFrames.Add(End);
 		}
+	}
 
-		Red -= Delta;
-		Green += Delta;	//should wrap
-		Alpha += DeltaAlpha;
-		//Alpha = (Alpha > 250) ? 150 : Alpha;
-		FColor Color(Red, 0, Green, Alpha);
-		OutMesh.VertexColors.Add(Color);
-		OutMesh.VertexColors.Add(Color);
-		OutMesh.VertexColors.Add(Color);
+	ComputeFrames(OutFrames);
+}
+
+void AProceduralSplineMesh::ComputeFrames(TArray<FProceduralSplineFrame>& InOutFrames)
+{
+	// Parallel transport: each normal is the previous one turned by the smallest rotation between the two tangents,
+	// so the frame never rolls on its own, not even where the spline goes vertical
+	FVector PrevTangent = FVector::ForwardVector;
+	FVector Normal = FVector::UpVector;
+	for (int32 Sample = 0; Sample < InOutFrames.Num(); Sample++)
+	{
+		FProceduralSplineFrame& Frame = InOutFrames[Sample];
+
+		FVector Tangent = Frame.Tangent.GetSafeNormal();
+		if (Tangent.IsZero())
+		{
+			Tangent = PrevTangent;
+		}
+
+		if (Sample == 0)
+		{
+			// Start upright, or facing forward if the spline starts vertical
+			Normal = FVector::UpVector - Tangent * (Tangent | FVector::UpVector);
+			if (Normal.SizeSquared() < KINDA_SMALL_NUMBER)
+			{
+				Normal = FVector::ForwardVector - Tangent * (Tangent | FVector::ForwardVector);
+			}
+		}
+		else
+		{
+			Normal = FQuat::FindBetween(PrevTangent, Tangent).RotateVector(Normal);
+			// Keep rounding errors from building up along the spline
+			Normal -= Tangent * (Tangent | Normal);
+		}
+		Normal.Normalize();
+
+		Frame.Tangent = Tangent;
+		Frame.Normal = Normal;
+		Frame.Binormal = Normal ^ Tangent;
+
+		PrevTangent = Tangent;
+	}
+}
+
+//TODO for testing only! Red and green bounce against each other and alpha between 1 and 25, as a function of the sample so sections line up
+static FColor TestColor(int32 Sample)
+{
+	const int32 GreenPhase = Sample % 126;
+	const int32 AlphaPhase = Sample % 48;
+	const uint8 Green = 1 + 4 * ((GreenPhase < 63) ? GreenPhase : 126 - GreenPhase);
+	const uint8 Alpha = 1 + ((AlphaPhase < 24) ? AlphaPhase : 48 - AlphaPhase);
+	return FColor(255 - Green, 0, Green, Alpha);
+}
+
+/** Close one end of the extrusion, facing out of it */
+static void AddCap(const FProceduralMeshExtrusionTemplate& InTemplate, const FProceduralSplineFrame& Frame, const FColor& Color, bool bBack, FProceduralMeshData& OutMesh)
+{
+	const FMatrix FrameMatrix(Frame.Tangent, Frame.Binormal, Frame.Normal, Frame.Position);
+	const FVector CapNormal = bBack ? Frame.Tangent : -Frame.Tangent;
+	const uint32 Base = OutMesh.VertexPositions.Num();
+
+	for (const FVector2D& Position : InTemplate.CapPositions)
+	{
+		OutMesh.VertexPositions.Add(FrameMatrix.TransformPosition(FVector(0.f, Position.X, Position.Y)));
+		OutMesh.VertexNormals.Add(CapNormal);
 		OutMesh.VertexColors.Add(Color);
+		OutMesh.UVChannels[0].UVs.Add(Position / InTemplate.TextureLength);
 	}
 
-	return true;
+	for (int32 CapIdx = 0; CapIdx < InTemplate.CapIndices.Num(); CapIdx += 3)
+	{
+		// The back cap is seen from the other side
+		OutMesh.AddTriangle(Base + InTemplate.CapIndices[CapIdx], Base + InTemplate.CapIndices[CapIdx + (bBack ? 2 : 1)], Base + InTemplate.CapIndices[CapIdx + (bBack ? 1 : 2)]);
+	}
+}
+
+void AProceduralSplineMesh::ExtrudeMesh(const TArray<FProceduralSplineFrame>& InFrames, const FProceduralMeshExtrusionTemplate& InTemplate, int32 FirstSegment, int32 NumSegments, FProceduralMeshData& OutMesh)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProceduralMesh_ExtrudeSpline);
+
+	const int32 LastSegment = InFrames.Num() - 2;
+	const int32 RingSize = InTemplate.RingSize();
+	const int32 NumRows = NumSegments + 1;
+	const int32 PatternSize = InTemplate.SegmentIndices.Num();
+	const bool bHasCaps = InTemplate.CapIndices.Num() > 0;
+	const int32 NumCaps = (bHasCaps && FirstSegment == 0 ? 1 : 0) + (bHasCaps && FirstSegment + NumSegments - 1 == LastSegment ? 1 : 0);
+
+	// Exact sizes are known up front
+	const int32 NumVertices = NumRows * RingSize + NumCaps * InTemplate.CapPositions.Num();
+	OutMesh.VertexPositions.Reserve(NumVertices);
+	OutMesh.VertexNormals.Reserve(NumVertices);
+	OutMesh.VertexColors.Reserve(NumVertices);
+	OutMesh.UVChannels.SetNum(1);
+	OutMesh.UVChannels[0].UVs.Reserve(NumVertices);
+	OutMesh.Indices.Reserve(NumSegments * PatternSize + NumCaps * InTemplate.CapIndices.Num());
+
+	//one ring per sample, X along the spline, Y to the right and Z up. Rows are relative to the first segment so they stay fixed within the section
+	for (int32 Sample = FirstSegment; Sample <= FirstSegment + NumSegments; Sample++)
+	{
+		const FProceduralSplineFrame& Frame = InFrames[Sample];
+		const FMatrix FrameMatrix(Frame.Tangent, Frame.Binormal, Frame.Normal, Frame.Position);
+		const FColor Color = TestColor(Sample);
+		const float V = Frame.Distance / InTemplate.TextureLength;
+
+		for (int32 RingIdx = 0; RingIdx < RingSize; RingIdx++)
+		{
+			const FVector2D& Position = InTemplate.RingPositions[RingIdx];
+			const FVector2D& Normal = InTemplate.RingNormals[RingIdx];
+			OutMesh.VertexPositions.Add(FrameMatrix.TransformPosition(FVector(0.f, Position.X, Position.Y)));
+			OutMesh.VertexNormals.Add(FrameMatrix.TransformVector(FVector(0.f, Normal.X, Normal.Y)));
+			OutMesh.VertexColors.Add(Color);
+			OutMesh.UVChannels[0].UVs.Add(FVector2D(InTemplate.RingU[RingIdx], V));
+		}
+	}
+
+	// Stamp the segment pattern out, one ring further each time
+	const int32 FirstIndex = OutMesh.Indices.Num();
+	OutMesh.Indices.AddUninitialized(NumSegments * PatternSize);
+	uint32* Dest = OutMesh.Indices.GetData() + FirstIndex;
+	for (int32 Segment = 0; Segment < NumSegments; Segment++)
+	{
+		const uint32 Offset = Segment * RingSize;
+		for (int32 PatternIdx = 0; PatternIdx < PatternSize; PatternIdx++)
+		{
+			*Dest++ = InTemplate.SegmentIndices[PatternIdx] + Offset;
+		}
+	}
+
+	//caps get their own vertices after the rows
+	if (bHasCaps && FirstSegment == 0)
+	{
+		AddCap(InTemplate, InFrames[0], TestColor(0), false, OutMesh);
+	}
+	if (bHasCaps && FirstSegment + NumSegments - 1 == LastSegment)
+	{
+		AddCap(InTemplate, InFrames[LastSegment + 1], TestColor(LastSegment + 1), true, OutMesh);
+	}
+}
+
+void AProceduralSplineMesh::ExtrudeMeshCached(const TArray<FProceduralSplineFrame>& InFrames, const FProceduralMeshExtrusionTemplate& InTemplate, int32 FirstSegment, int32 NumSegments, FProceduralMeshData& OutMesh)
+{
+	// Everything ExtrudeMesh reads: the frames of the section, where it lies on the spline (colors and caps) and the template.
+	// Bump the version whenever ExtrudeMesh changes its output
+	FProceduralMeshCacheKey Key(TEXT("SplineExtrusion"), 1);
+	Key.Update(FirstSegment);
+	Key.Update(NumSegments);
+	Key.Update(InFrames.Num());
+	Key.Update(InFrames.GetData() + FirstSegment, (NumSegments + 1) * sizeof(FProceduralSplineFrame));
+	Key.Update(InTemplate.RingPositions);
+	Key.Update(InTemplate.RingNormals);
+	Key.Update(InTemplate.RingU);
+	Key.Update(InTemplate.SegmentIndices);
+	Key.Update(InTemplate.CapPositions);
+	Key.Update(InTemplate.CapIndices);
+	Key.Update(InTemplate.TextureLength);
+
+	FProceduralMeshCache::GetOrGenerate(Key.Finalize(), OutMesh, [&](FProceduralMeshData& GeneratedMesh)
+	{
+		ExtrudeMesh(InFrames, InTemplate, FirstSegment, NumSegments, GeneratedMesh);
+	});
 }
 
 void AProceduralSplineMesh::ChangeColor(FLinearColor InColor, float Intensity)
 {
-	static int32 NumberOfVertices = 4 * NumberOfSegments + 4;
+	const int32 NumberOfSamples = NumberOfSegments + 1;
 
 	static int32 CurrentSet = 0;
 
@@ -230,22 +540,31 @@ void AProceduralSplineMesh::ChangeColor(FLinearColor InColor, float Intensity)
 	FColor AsColor(InColor);
 	AsColor.A = Intensity;
 
-	FProceduralMeshData& MeshData = Mesh->GetMeshData();
-	/*MeshData.VertexColors.Reset();
-
+	if (!Template.IsValid())
+	{
+		return;
+	}
 
-	for (int32 i = 0; i < NumberOfVertices; i++)
+	//CurrentSet is a sample, a sample on a section boundary is a ring of both sections
+	const int32 Sample = CurrentSet % NumberOfSamples;
+	const int32 RingSize = Template->RingSize();
+	const int32 SectionSize = FMath::Max(BuiltSegmentsPerSection, 1);
+	for (int32 Section = FMath::Max(Sample - 1, 0) / SectionSize; Section <= Sample / SectionSize && Section < Mesh->GetNumSections(); Section++)
 	{
-		MeshData.VertexColors.Add(AsColor);
-	}*/
+		const int32 Row = (Sample - Section * SectionSize) * RingSize;
+		FProceduralMeshData& MeshData = Mesh->GetMeshSectionData(Section);
+		if (Row + RingSize > MeshData.VertexColors.Num())
+		{
+			continue;
+		}
 
-	MeshData.VertexColors[CurrentSet] = AsColor;
-	MeshData.VertexColors[CurrentSet + 1] = AsColor;
-	MeshData.VertexColors[CurrentSet + 2] = AsColor;
-	MeshData.VertexColors[CurrentSet + 3] = AsColor;
+		for (int32 RingIdx = 0; RingIdx < RingSize; RingIdx++)
+		{
+			MeshData.VertexColors[Row + RingIdx] = AsColor;
+		}
 
-	Mesh->MarkRenderStateDirty();
+		Mesh->UpdateVertexColors(Row, RingSize, Section);
+	}
 
-	CurrentSet += 4;
-	CurrentSet %= NumberOfVertices;
+	CurrentSet = (Sample + 1) % NumberOfSamples;
 }
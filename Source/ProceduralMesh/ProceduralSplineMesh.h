@@ -5,8 +5,75 @@
 #include "GameFramework/Actor.h"
 #include "Components/SplineComponent.h"
 #include "ProceduralMeshComponent.h"
+#include "ProceduralMeshProfile.h"
 #include "ProceduralSplineMesh.generated.h"
 
+/**Position and axes of the spline at one sample: X along the tangent, Y to the right (binormal) and Z up (normal)*/
+struct FProceduralSplineFrame
+{
+	FVector Position;
+	FVector Tangent;
+	FVector Normal;
+	FVector Binormal;
+
+	/**Distance along the spline*/
+	float Distance;
+
+	/**Tolerant compare, an edit can turn the transported frames after it by rounding amounts*/
+	bool Equals(const FProceduralSplineFrame& Other) const
+	{
+		return Position.Equals(Other.Position, 0.01f) && Tangent.Equals(Other.Tangent, 1.e-4f) && Normal.Equals(Other.Normal, 1.e-4f);
+	}
+};
+
+/**Adaptive sampling of a spline mesh*/
+USTRUCT(BlueprintType)
+struct FProceduralSplineTessellation
+{
+	GENERATED_USTRUCT_BODY()
+
+	/**Place samples by the error tolerances below instead of every SegmentLength*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tessellation")
+		bool bAdaptive;
+
+	/**Largest distance allowed between the spline and the middle of a segment*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tessellation", meta = (ClampMin = "0.0"))
+		float MaxChordError;
+
+	/**Largest turn of the spline along one segment, in degrees*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tessellation", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+		float MaxAngleError;
+
+	/**Segments are never shorter than this, except a whole spline that is*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tessellation", meta = (ClampMin = "1.0"))
+		float MinSegmentLength;
+
+	/**Segments are never longer than this, even on straight runs*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tessellation", meta = (ClampMin = "1.0"))
+		float MaxSegmentLength;
+
+	FProceduralSplineTessellation()
+		: bAdaptive(false)
+		, MaxChordError(1.f)
+		, MaxAngleError(5.f)
+		, MinSegmentLength(10.f)
+		, MaxSegmentLength(1000.f)
+	{
+	}
+
+	bool operator==(const FProceduralSplineTessellation& Other) const
+	{
+		return bAdaptive == Other.bAdaptive && MaxChordError == Other.MaxChordError && MaxAngleError == Other.MaxAngleError &&
+			MinSegmentLength == Other.MinSegmentLength && MaxSegmentLength == Other.MaxSegmentLength;
+	}
+};
+
+/**Frame table shared with the generators still using it*/
+typedef TSharedPtr<const TArray<FProceduralSplineFrame>, ESPMode::ThreadSafe> FProceduralSplineFramesPtr;
+
+/**Topology template shared with the generators still using it*/
+typedef TSharedPtr<const FProceduralMeshExtrusionTemplate, ESPMode::ThreadSafe> FProceduralMeshTemplatePtr;
+
 UCLASS()
 class PROCEDURALMESH_API  AProceduralSplineMesh : public AActor
 {
@@ -35,6 +102,10 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Procedural Spline Mesh")
 		UProceduralMeshComponent* Mesh;
 
+	/**Cross section extruded along the spline, a MeshWidth by MeshHeight box when not set*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
+		UProceduralMeshProfile* Profile;
+
 	/**Height that the mesh should be*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
 		float MeshHeight;
@@ -43,11 +114,19 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
 		float MeshWidth;
 
-	/**Length of a segment, ie how often the spline should be sampled, higer is smoother but more performance hungry*/
+	/**Length of a segment, ie how often the spline should be sampled, higer is smoother but more performance hungry. Unused with adaptive Tessellation*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
 		float SegmentLength;
 
-	/**Caculated number of segments*/
+	/**Segments per mesh section, an edit only regenerates and uploads the sections whose samples changed*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
+		int32 SegmentsPerSection;
+
+	/**Adaptive sampling, replaces SegmentLength when enabled*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
+		FProceduralSplineTessellation Tessellation;
+
+	/**Caculated number of segments, fixed or adaptive*/
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Procedural Spline Mesh")
 		int32 NumberOfSegments;
 
@@ -56,7 +135,37 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Procedural Spline Mesh")
 		void ChangeColor(FLinearColor InColor, float Intensity);
 
+	/**Turn the sampled tangents into rotation minimizing (parallel transport) frames*/
+	static void ComputeFrames(TArray<FProceduralSplineFrame>& InOutFrames);
+
+	/**Extrude the profile along segments [FirstSegment, FirstSegment + NumSegments), capped at the ends of the spline. Touches no UObject so it can run on a worker thread*/
+	static void ExtrudeMesh(const TArray<FProceduralSplineFrame>& InFrames, const FProceduralMeshExtrusionTemplate& InTemplate, int32 FirstSegment, int32 NumSegments, FProceduralMeshData& OutMesh);
+
 private:
 
-	bool CreateMesh(FProceduralMeshData& OutMesh);
+	/**Sample the spline if it changed and regenerate the sections built from frames that changed, all of them if the layout changed.
+	 * bUseCache loads sections from the disk cache (see FProceduralMeshCache), for construction and final edits but not every step of a drag*/
+	void UpdateMesh(bool bAsync, bool bUseCache);
+
+	/**Sample a frame at every segment boundary in one sweep along the spline, in spline space. Boundaries are every SegmentLength or placed by Tessellation*/
+	void SampleSpline(TArray<FProceduralSplineFrame>& OutFrames);
+
+	static bool IsSameCurve(const FInterpCurveVector& A, const FInterpCurveVector& B);
+
+	/**ExtrudeMesh through the disk cache, keyed by the frames of the section (the spline points, SegmentLength and Tessellation) and the template (the profile, MeshWidth and MeshHeight)*/
+	static void ExtrudeMeshCached(const TArray<FProceduralSplineFrame>& InFrames, const FProceduralMeshExtrusionTemplate& InTemplate, int32 FirstSegment, int32 NumSegments, FProceduralMeshData& OutMesh);
+
+	/**Frames the current sections were built from, sampled from SampledSplineInfo with the sampled settings*/
+	FProceduralSplineFramesPtr Frames;
+	FInterpCurveVector SampledSplineInfo;
+	float SampledSegmentLength;
+	FProceduralSplineTessellation SampledTessellation;
+
+	/**Template and section size the current sections were built with*/
+	FProceduralMeshTemplatePtr Template;
+	int32 BuiltSegmentsPerSection;
+
+	/**An interactive edit (drag) overrides Mesh->bDeferCollisionUpdates until its final change, which restores the saved value*/
+	bool bDeferringCollision;
+	bool bSavedDeferCollisionUpdates;
 };
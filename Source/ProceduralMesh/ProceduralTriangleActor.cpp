@@ -18,7 +18,7 @@ AProceduralTriangleActor::AProceduralTriangleActor()
 	TArray<FProceduralMeshTriangle> triangles;
 	FProceduralMeshData MeshData;
 	GenerateTriangle(MeshData);
-	mesh->SetMeshData(MeshData);
+	mesh->SetMeshData(MoveTemp(MeshData));
 
 	RootComponent = mesh;
 }